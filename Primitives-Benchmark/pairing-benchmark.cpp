@@ -3,17 +3,22 @@
 #include <chrono>
 #include <vector>
 #include <cmath>
+#include"../SGKD-Protocol/perf.cpp"
+#include"../SGKD-Protocol/update_kernel.cpp"
 
 using namespace std;
 using namespace std::chrono;
 // Compile with: g++ relic-pairing-benchmark.cpp -o pairing-bench -lrelic -lgmp
+#define INNER_LOOP 100
+#define OUTER_LOOP 100
 
 // Benchmark function measuring average + stddev over batches
 template <typename F>
-pair<double, double> benchmark_stats(F func,int inner_loop = 1000, int outer_loop = 1000) {
+pair<double, double> benchmark_stats(F func,int inner_loop = INNER_LOOP, int outer_loop = OUTER_LOOP) {
     vector<double> samples;
-    samples.reserve(OUTER_LOOP);
+    samples.reserve(outer_loop);
 
+    perf_begin();
     for (int i = 0; i < outer_loop; ++i) {
         auto start = high_resolution_clock::now();
         for (int j = 0; j < inner_loop; ++j) {
@@ -23,6 +28,7 @@ pair<double, double> benchmark_stats(F func,int inner_loop = 1000, int outer_loo
         double batch_time = duration_cast<nanoseconds>(end - start).count();
         samples.push_back(batch_time / inner_loop);
     }
+    perf_end(uint64_t(inner_loop) * outer_loop);
 
     double sum = 0.0;
     for (double t : samples) sum += t;
@@ -80,6 +86,50 @@ int main() {
     cout << "RELIC pairing benchmark (" << OUTER_LOOP << " batches of " << INNER_LOOP << "):\n";
     cout << "Average time: " << avg_ns << " ns\n";
     cout << "Standard deviation: " << std_dev << " ns\n";
+    perf_report("pc_map", avg_ns, std_dev);
+
+    // The group operations of a member key update
+    bn_t e;
+    bn_new(e);
+    bn_rand_mod(e, order);
+    auto [g2_mul_avg, g2_mul_std] = benchmark_stats([&]() {
+        ep2_mul(bQ, Q, e);
+    });
+    cout << "g2_mul:             " << g2_mul_avg << " ns (±" << g2_mul_std << ")\n";
+    perf_report("g2_mul", g2_mul_avg, g2_mul_std);
+
+    auto [inv_avg, inv_std] = benchmark_stats([&]() {
+        bn_mod_inv(b, e, order);
+    });
+    cout << "bn_mod_inv:         " << inv_avg << " ns (±" << inv_std << ")\n";
+    perf_report("bn_mod_inv", inv_avg, inv_std);
+
+    // The member's w2 update: two multiplications, a negation and an addition,
+    // against the kernel's subtraction and single multiplication
+    g2_t w2, t1, t2;
+    g2_new(w2); g2_new(t1); g2_new(t2);
+    g2_rand(w2);
+    g2_mul(t1, w2, e);
+    g2_mul(t2, Q, e);
+    g2_neg(t1, t1);
+    g2_add(t2, t2, t1);
+    g2_update_w2(w2, Q, e, t1);
+    cout << "w2 update kernel matches: " << (g2_cmp(w2, t2) == RLC_EQ ? "yes" : "NO") << "\n";
+    auto [two_avg, two_std] = benchmark_stats([&]() {
+        g2_mul(t1, w2, e);
+        g2_mul(t2, Q, e);
+        g2_neg(t1, t1);
+        g2_add(w2, t2, t1);
+    });
+    cout << "w2 update (2 muls): " << two_avg << " ns (±" << two_std << ")\n";
+    perf_report("w2_update_two_mul", two_avg, two_std);
+    auto [kernel_avg, kernel_std] = benchmark_stats([&]() {
+        g2_update_w2(w2, Q, e, t1);
+    });
+    cout << "w2 update (kernel): " << kernel_avg << " ns (±" << kernel_std << ")\n";
+    perf_report("w2_update_kernel", kernel_avg, kernel_std);
+    g2_free(w2); g2_free(t1); g2_free(t2);
+    bn_free(e);
 
     // Clean up
     ep_free(P); ep_free(aP);
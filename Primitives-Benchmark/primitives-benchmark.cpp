@@ -2,6 +2,14 @@
 #include <chrono>
 #include <vector>
 #include <cmath>
+#include <cstring>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <memory>
+#include <openssl/core_names.h>
+#include <openssl/kdf.h>
 #include <openssl/evp.h>
 #include <openssl/ec.h>
 #include <openssl/ecdsa.h>
@@ -11,16 +19,23 @@
 #include <openssl/aes.h>
 #include <openssl/bn.h>
 #include <openssl/err.h>
+#include"../SGKD-Protocol/perf.cpp"
 
 using namespace std;
 using namespace std::chrono;
 // Compile with: g++ openssl-benchmark.cpp -o openssl-bench -lssl -lcrypto
 
+#define THROUGHPUT_MAX_SIZE (64 * 1024)
+#define THROUGHPUT_RUN_MS 200        // timed run per (kernel, size, threads) point
+#define THROUGHPUT_SCALING_SIZE 4096 // message size used for the thread-scaling sweep
+#define THROUGHPUT_BATCH 16          // operations between checks of the stop flag
+
 template <typename F>
 pair<double, double> benchmark_stats(F func, int inner_loop = 1000, int outer_loop = 1) {
     vector<double> times;
     times.reserve(outer_loop);
 
+    perf_begin();
     for (int i = 0; i < outer_loop; ++i) {
         auto start = high_resolution_clock::now();
         for (int j = 0; j < inner_loop; ++j) func();
@@ -28,6 +43,7 @@ pair<double, double> benchmark_stats(F func, int inner_loop = 1000, int outer_lo
         double total = duration_cast<nanoseconds>(end - start).count();
         times.push_back(total / inner_loop);
     }
+    perf_end(uint64_t(inner_loop) * outer_loop);
 
     double sum = 0.0;
     for (double t : times) sum += t;
@@ -40,8 +56,189 @@ pair<double, double> benchmark_stats(F func, int inner_loop = 1000, int outer_lo
     return {mean, stddev};
 }
 
+// Throughput mode.
+//
+// Each kernel's prepare() runs once per thread, outside the timed region: it fetches
+// the algorithm, allocates the context and sets the key. The returned operation
+// processes one message of len bytes with no allocation or key schedule. Timed runs
+// therefore measure the primitive itself and report bytes/s of message processed.
+typedef function<void(const uint8_t*, size_t)> ThroughputOp;
+
+struct ThroughputKernel {
+    const char* name;
+    function<ThroughputOp()> prepare;
+};
+
+static const unsigned char bench_key[32] = "0123456789abcdef0123456789abcde";
+static const unsigned char bench_iv[16] = "fedcba987654321";
+
+vector<ThroughputKernel> throughput_kernels() {
+    return {
+        {"SHA-256", [] {
+            shared_ptr<EVP_MD> md(EVP_MD_fetch(NULL, "SHA256", NULL), EVP_MD_free);
+            shared_ptr<EVP_MD_CTX> ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+            return ThroughputOp([md, ctx](const uint8_t* msg, size_t len) {
+                unsigned char out[EVP_MAX_MD_SIZE];
+                EVP_DigestInit_ex2(ctx.get(), md.get(), NULL);
+                EVP_DigestUpdate(ctx.get(), msg, len);
+                EVP_DigestFinal_ex(ctx.get(), out, NULL);
+            });
+        }},
+        {"HMAC-SHA256", [] {
+            shared_ptr<EVP_MAC> mac(EVP_MAC_fetch(NULL, "HMAC", NULL), EVP_MAC_free);
+            shared_ptr<EVP_MAC_CTX> ctx(EVP_MAC_CTX_new(mac.get()), EVP_MAC_CTX_free);
+            OSSL_PARAM params[] = {OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, (char*)"SHA256", 0),
+                                   OSSL_PARAM_construct_end()};
+            EVP_MAC_init(ctx.get(), bench_key, sizeof(bench_key), params);
+            return ThroughputOp([mac, ctx](const uint8_t* msg, size_t len) {
+                unsigned char out[EVP_MAX_MD_SIZE];
+                size_t out_len;
+                EVP_MAC_init(ctx.get(), NULL, 0, NULL); // keeps the key set above
+                EVP_MAC_update(ctx.get(), msg, len);
+                EVP_MAC_final(ctx.get(), out, &out_len, sizeof(out));
+            });
+        }},
+        // HKDF-SHA256 with the message as input key material and a 32-byte output. The
+        // parameters are set when the op first sees a message (the untimed warm-up) and
+        // stay on the context, so timed calls run EVP_KDF_derive alone.
+        {"HKDF-SHA256", [] {
+            shared_ptr<EVP_KDF> kdf(EVP_KDF_fetch(NULL, "HKDF", NULL), EVP_KDF_free);
+            shared_ptr<EVP_KDF_CTX> ctx(EVP_KDF_CTX_new(kdf.get()), EVP_KDF_CTX_free);
+            shared_ptr<pair<const uint8_t*, size_t>> bound = make_shared<pair<const uint8_t*, size_t>>(nullptr, 0);
+            return ThroughputOp([kdf, ctx, bound](const uint8_t* msg, size_t len) {
+                unsigned char out[32];
+                if (bound->first != msg || bound->second != len) {
+                    OSSL_PARAM params[] = {
+                        OSSL_PARAM_construct_utf8_string(OSSL_KDF_PARAM_DIGEST, (char*)"SHA256", 0),
+                        OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_KEY, (void*)msg, len),
+                        OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_SALT, (void*)bench_iv, sizeof(bench_iv)),
+                        OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_INFO, (void*)"info", 4),
+                        OSSL_PARAM_construct_end()};
+                    EVP_KDF_CTX_set_params(ctx.get(), params);
+                    *bound = {msg, len};
+                }
+                EVP_KDF_derive(ctx.get(), out, sizeof(out), NULL);
+            });
+        }},
+        // The IV is reused across operations; fine for timing, never for real traffic.
+        {"AES-256-GCM", [] {
+            shared_ptr<EVP_CIPHER> cipher(EVP_CIPHER_fetch(NULL, "AES-256-GCM", NULL), EVP_CIPHER_free);
+            shared_ptr<EVP_CIPHER_CTX> ctx(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
+            shared_ptr<vector<uint8_t>> out = make_shared<vector<uint8_t>>(THROUGHPUT_MAX_SIZE + 32);
+            EVP_EncryptInit_ex2(ctx.get(), cipher.get(), bench_key, bench_iv, NULL);
+            return ThroughputOp([cipher, ctx, out](const uint8_t* msg, size_t len) {
+                int n;
+                unsigned char tag[16];
+                EVP_EncryptInit_ex2(ctx.get(), NULL, NULL, bench_iv, NULL);
+                EVP_EncryptUpdate(ctx.get(), out->data(), &n, msg, len);
+                EVP_EncryptFinal_ex(ctx.get(), out->data() + n, &n);
+                EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_GET_TAG, sizeof(tag), tag);
+            });
+        }},
+        {"AES-256-CBC", [] {
+            shared_ptr<EVP_CIPHER> cipher(EVP_CIPHER_fetch(NULL, "AES-256-CBC", NULL), EVP_CIPHER_free);
+            shared_ptr<EVP_CIPHER_CTX> ctx(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
+            shared_ptr<vector<uint8_t>> out = make_shared<vector<uint8_t>>(THROUGHPUT_MAX_SIZE + 32);
+            EVP_EncryptInit_ex2(ctx.get(), cipher.get(), bench_key, bench_iv, NULL);
+            EVP_CIPHER_CTX_set_padding(ctx.get(), 0); // all sweep sizes are block multiples
+            return ThroughputOp([cipher, ctx, out](const uint8_t* msg, size_t len) {
+                int n;
+                EVP_EncryptInit_ex2(ctx.get(), NULL, NULL, bench_iv, NULL);
+                EVP_EncryptUpdate(ctx.get(), out->data(), &n, msg, len);
+                EVP_EncryptFinal_ex(ctx.get(), out->data() + n, &n);
+            });
+        }},
+    };
+}
+
+// Runs kernel k on len-byte messages on `threads` threads for THROUGHPUT_RUN_MS and
+// returns the aggregate bytes/s. Threads prepare first and start together.
+double measure_throughput(const ThroughputKernel& k, size_t len, int threads) {
+    atomic<int> ready{0};
+    atomic<bool> go{false}, stop{false};
+    vector<uint64_t> ops(threads, 0);
+    vector<thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            ThroughputOp op = k.prepare();
+            vector<uint8_t> msg(len);
+            RAND_bytes(msg.data(), len);
+            op(msg.data(), len); // warm-up
+            ready.fetch_add(1);
+            while (!go.load(memory_order_acquire)) this_thread::yield();
+            uint64_t n = 0;
+            while (!stop.load(memory_order_relaxed)) {
+                for (int i = 0; i < THROUGHPUT_BATCH; ++i) op(msg.data(), len);
+                n += THROUGHPUT_BATCH;
+            }
+            ops[t] = n;
+        });
+    }
+    while (ready.load() < threads) this_thread::yield();
+    auto start = high_resolution_clock::now();
+    go.store(true, memory_order_release);
+    this_thread::sleep_for(milliseconds(THROUGHPUT_RUN_MS));
+    stop.store(true);
+    for (thread& t : pool) t.join();
+    double seconds = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+    uint64_t total = 0;
+    for (uint64_t n : ops) total += n;
+    return total * len / seconds;
+}
+
+string format_rate(double bytes_per_s) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%10.1f", bytes_per_s / 1e6);
+    return buf;
+}
+
+void run_throughput(int max_threads) {
+    vector<ThroughputKernel> kernels = throughput_kernels();
+
+    cout << "Throughput (MB/s, 1 thread, setup outside the timed region)\n";
+    cout << "Size      ";
+    for (const ThroughputKernel& k : kernels) printf("%12s", k.name);
+    cout << "\n";
+    for (size_t len = 16; len <= THROUGHPUT_MAX_SIZE; len *= 4) {
+        printf("%-10zu", len);
+        for (const ThroughputKernel& k : kernels) cout << "  " << format_rate(measure_throughput(k, len, 1));
+        cout << "\n";
+    }
+
+    cout << "\nScaling (MB/s at " << THROUGHPUT_SCALING_SIZE << " B, efficiency vs 1 thread)\n";
+    cout << "Threads   ";
+    for (const ThroughputKernel& k : kernels) printf("%19s", k.name);
+    cout << "\n";
+    vector<double> single(kernels.size());
+    for (int threads = 1; threads <= max_threads; threads = threads < max_threads ? min(threads * 2, max_threads) : threads + 1) {
+        printf("%-10d", threads);
+        for (size_t i = 0; i < kernels.size(); ++i) {
+            double rate = measure_throughput(kernels[i], THROUGHPUT_SCALING_SIZE, threads);
+            if (threads == 1) single[i] = rate;
+            printf("  %s (%3.0f%%)", format_rate(rate).c_str(), 100.0 * rate / (threads * single[i]));
+        }
+        cout << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    int max_threads = 0;
+    bool throughput = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--throughput") throughput = true;
+        else if (arg == "--threads" && i + 1 < argc) max_threads = atoi(argv[++i]);
+        else {
+            cerr << "Usage: " << argv[0] << " [--throughput [--threads N]]\n";
+            return 1;
+        }
+    }
+    if (throughput) {
+        if (max_threads <= 0) max_threads = max(1u, thread::hardware_concurrency());
+        run_throughput(max_threads);
+        return 0;
+    }
 
-int main() {
     ERR_load_crypto_strings();
     OpenSSL_add_all_algorithms();
 
@@ -55,6 +252,7 @@ int main() {
         SHA256(input, sizeof(input), hash_out);
     });
     cout << "SHA256 Hash:         " << sha_avg << " ns (±" << sha_std << ")\n";
+    perf_report("sha256", sha_avg, sha_std);
 
     // HMAC-SHA256
     unsigned char hkey[] = "secret-key";
@@ -65,6 +263,7 @@ int main() {
         HMAC(EVP_sha256(), hkey, strlen((char *)hkey), hdata, strlen((char *)hdata), hmac_out, &hmac_len);
     });
     cout << "HMAC-SHA256:         " << hmac_avg << " ns (±" << hmac_std << ")\n";
+    perf_report("hmac_sha256", hmac_avg, hmac_std);
 
     // AES-CBC Encryption
     auto [aes_avg, aes_std] = benchmark_stats([]() {
@@ -77,6 +276,7 @@ int main() {
         AES_cbc_encrypt(pt, ct, sizeof(pt), &aes, iv, AES_ENCRYPT);
     });
     cout << "AES-CBC Encryption:  " << aes_avg << " ns (±" << aes_std << ")\n";
+    perf_report("aes_cbc", aes_avg, aes_std);
 
     // HKDF (simplified)
     auto [hkdf_avg, hkdf_std] = benchmark_stats([]() {
@@ -95,6 +295,7 @@ int main() {
         HMAC_CTX_free(ctx);
     });
     cout << "HKDF-SHA256:         " << hkdf_avg << " ns (±" << hkdf_std << ")\n";
+    perf_report("hkdf_sha256", hkdf_avg, hkdf_std);
 
     // Modular Exponentiation
     auto [modexp_avg, modexp_std] = benchmark_stats([]() {
@@ -107,6 +308,7 @@ int main() {
         BN_free(a); BN_free(b); BN_free(m); BN_free(r); BN_CTX_free(ctx);
     });
     cout << "Modular Exp:         " << modexp_avg << " ns (±" << modexp_std << ")\n";
+    perf_report("mod_exp", modexp_avg, modexp_std);
 
     // Modular Inverse
     auto [modinv_avg, modinv_std] = benchmark_stats([]() {
@@ -118,6 +320,7 @@ int main() {
         BN_free(a); BN_free(m); BN_free(r); BN_CTX_free(ctx);
     });
     cout << "Modular Inverse:     " << modinv_avg << " ns (±" << modinv_std << ")\n";
+    perf_report("mod_inv", modinv_avg, modinv_std);
 
     // EC Scalar Mult & Point Addition
     EC_GROUP *group = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
@@ -132,6 +335,7 @@ int main() {
         BN_free(k);
     });
     cout << "EC Scalar Mult:      " << ec_mult_avg << " ns (±" << ec_mult_std << ")\n";
+    perf_report("ec_scalar_mult", ec_mult_avg, ec_mult_std);
 
     EC_POINT *P = EC_POINT_new(group), *Q = EC_POINT_new(group);
     BIGNUM *k1 = BN_new(), *k2 = BN_new();
@@ -146,6 +350,7 @@ int main() {
         EC_POINT_free(R);
     });
     cout << "EC Point Addition:   " << ec_add_avg << " ns (±" << ec_add_std << ")\n";
+    perf_report("ec_point_add", ec_add_avg, ec_add_std);
 
     EC_POINT_free(P); EC_POINT_free(Q); BN_free(k1); BN_free(k2);
     EC_GROUP_free(group);
@@ -177,6 +382,8 @@ int main() {
         EVP_DigestSign(ctx, sigbuf, &len, m, sizeof(m));
         EVP_MD_CTX_free(ctx);
     });
+    cout << "ECDSA Sign:          " << sign_avg << " ns (±" << sign_std << ")\n";
+    perf_report("ecdsa_sign", sign_avg, sign_std);
 
     // Prepare valid signature for verify benchmark
     RAND_bytes(msg, sizeof(msg));
@@ -192,9 +399,10 @@ int main() {
         EVP_MD_CTX_free(ctx);
     });
 
-    cout << "ECDSA Sign:          " << sign_avg << " ns (±" << sign_std << ")\n";
     cout << "ECDSA Verify:        " << verify_avg << " ns (±" << verify_std << ")\n";
 
+    perf_report("ecdsa_verify", verify_avg, verify_std);
+
     // Cleanup
     delete[] sigbuf;
     EVP_PKEY_free(pkey);
@@ -0,0 +1,546 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/kdf.h>
+#include <openssl/params.h>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+
+// Authenticated registration handshake with resumable session tickets.
+//
+// Full handshake (first contact):
+//   V -> TA  HS_FULL | cert_V | eph_V | nonce_V | sig_V(hello)
+//   TA -> V  cert_TA | eph_TA | nonce_TA | sig_TA(hello, cert_TA, eph_TA, nonce_TA)
+//   V -> TA  HMAC(confirm, hello | cert_TA | eph_TA | nonce_TA | sig_TA)
+//   TA -> V  sealed
+// Both certificates are compact P-256 certificates signed by the fleet CA. The session
+// key, a resumption secret and a confirmation key come from HKDF over the ephemeral
+// ECDH secret. The confirmation covers nonce_TA, so a replayed hello fails before the
+// TA issues anything.
+//
+// Resumed handshake (reboot or catch-up after an outage), symmetric crypto only:
+//   V -> TA  HS_RESUME | ticket | nonce_V | HMAC(resumption, ticket | nonce_V)
+//   TA -> V  nonce_TA | sealed
+// The ticket is AES-256-GCM(ticket_key, id | resumption | expiry), opaque to the vehicle.
+//
+// "sealed" is AES-256-GCM(session key, payload) where the payload is the member
+// credential followed by a fresh ticket. Every field is sent as an int length followed
+// by the bytes, like the unauthenticated registration.
+
+#define HS_FULL 0x01
+#define HS_RESUME 0x02
+#define AUTH_ID_LEN 16
+#define AUTH_NONCE_LEN 32
+#define AUTH_KEY_LEN 32
+#define AUTH_FULL_KEYS (3 * AUTH_KEY_LEN) // session key | resumption | confirmation
+#define AUTH_PUB_LEN 65 // uncompressed P-256 point
+#define AUTH_GCM_IV_LEN 12
+#define AUTH_GCM_TAG_LEN 16
+#define AUTH_MAX_BLOB 4096
+#define AUTH_CERT_LIFETIME (365 * 24 * 3600)
+#define AUTH_TICKET_LIFETIME (7 * 24 * 3600)
+#define AUTH_ROLE_VEHICLE 0
+#define AUTH_ROLE_TA 1
+
+typedef std::vector<uint8_t> Bytes;
+
+void auth_append(Bytes& out, const uint8_t* p, size_t n) { out.insert(out.end(), p, p + n); }
+void auth_append(Bytes& out, const Bytes& b) { out.insert(out.end(), b.begin(), b.end()); }
+void auth_append_u64(Bytes& out, uint64_t v) { for (int i = 0; i < 8; ++i) out.push_back(uint8_t(v >> (8 * i))); }
+uint64_t auth_read_u64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v |= uint64_t(p[i]) << (8 * i);
+    return v;
+}
+
+// Length-prefixed field inside a payload, same framing as on the socket.
+void auth_append_blob(Bytes& out, const Bytes& b) {
+    int len = b.size();
+    auth_append(out, (const uint8_t*)&len, sizeof(len));
+    auth_append(out, b);
+}
+bool auth_take_blob(const Bytes& in, size_t& off, Bytes& out) {
+    int len;
+    if (in.size() - off < sizeof(len)) return false;
+    memcpy(&len, in.data() + off, sizeof(len));
+    off += sizeof(len);
+    if (len < 0 || (size_t)len > in.size() - off) return false;
+    out.assign(in.begin() + off, in.begin() + off + len);
+    off += len;
+    return true;
+}
+
+bool auth_send_blob(int sock, const Bytes& b) {
+    int len = b.size();
+    return send(sock, &len, sizeof(len), MSG_NOSIGNAL) == (ssize_t)sizeof(len) &&
+           (len == 0 || send(sock, b.data(), len, MSG_NOSIGNAL) == len);
+}
+bool auth_recv_blob(int sock, Bytes& out) {
+    int len;
+    if (recv(sock, &len, sizeof(len), MSG_WAITALL) != (ssize_t)sizeof(len)) return false;
+    if (len < 0 || len > AUTH_MAX_BLOB) return false;
+    out.resize(len);
+    return len == 0 || recv(sock, out.data(), len, MSG_WAITALL) == len;
+}
+
+Bytes auth_random(size_t n) {
+    Bytes b(n);
+    RAND_bytes(b.data(), n);
+    return b;
+}
+
+Bytes auth_sha256(const Bytes& b) {
+    Bytes d(SHA256_DIGEST_LENGTH);
+    SHA256(b.data(), b.size(), d.data());
+    return d;
+}
+
+// HKDF-SHA256(ikm, salt, info) -> out_len bytes.
+Bytes auth_hkdf(const Bytes& ikm, const Bytes& salt, const char* info, size_t out_len) {
+    Bytes out(out_len);
+    EVP_KDF* kdf = EVP_KDF_fetch(NULL, "HKDF", NULL);
+    EVP_KDF_CTX* kctx = EVP_KDF_CTX_new(kdf);
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_KDF_PARAM_DIGEST, (char*)"SHA256", 0),
+        OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_KEY, (void*)ikm.data(), ikm.size()),
+        OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_SALT, (void*)salt.data(), salt.size()),
+        OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_INFO, (void*)info, strlen(info)),
+        OSSL_PARAM_construct_end()};
+    if (!kctx || EVP_KDF_derive(kctx, out.data(), out_len, params) <= 0) out.clear();
+    EVP_KDF_CTX_free(kctx);
+    EVP_KDF_free(kdf);
+    return out;
+}
+
+Bytes auth_hmac(const Bytes& key, const Bytes& data) {
+    Bytes mac(SHA256_DIGEST_LENGTH);
+    unsigned int len = 0;
+    HMAC(EVP_sha256(), key.data(), key.size(), data.data(), data.size(), mac.data(), &len);
+    return mac;
+}
+
+// AES-256-GCM: returns iv | ciphertext | tag.
+Bytes auth_seal(const uint8_t* key, const char* aad, const Bytes& pt) {
+    Bytes out = auth_random(AUTH_GCM_IV_LEN);
+    out.resize(AUTH_GCM_IV_LEN + pt.size() + AUTH_GCM_TAG_LEN);
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    int len = 0;
+    bool ok = EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, out.data()) > 0 &&
+              EVP_EncryptUpdate(ctx, NULL, &len, (const uint8_t*)aad, strlen(aad)) > 0 &&
+              EVP_EncryptUpdate(ctx, out.data() + AUTH_GCM_IV_LEN, &len, pt.data(), pt.size()) > 0 &&
+              EVP_EncryptFinal_ex(ctx, out.data() + AUTH_GCM_IV_LEN + len, &len) > 0 &&
+              EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, AUTH_GCM_TAG_LEN,
+                                  out.data() + AUTH_GCM_IV_LEN + pt.size()) > 0;
+    EVP_CIPHER_CTX_free(ctx);
+    if (!ok) out.clear();
+    return out;
+}
+
+bool auth_open(const uint8_t* key, const char* aad, const Bytes& in, Bytes& pt) {
+    if (in.size() < AUTH_GCM_IV_LEN + AUTH_GCM_TAG_LEN) return false;
+    size_t ct_len = in.size() - AUTH_GCM_IV_LEN - AUTH_GCM_TAG_LEN;
+    pt.resize(ct_len);
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    int len = 0;
+    bool ok = EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, in.data()) > 0 &&
+              EVP_DecryptUpdate(ctx, NULL, &len, (const uint8_t*)aad, strlen(aad)) > 0 &&
+              EVP_DecryptUpdate(ctx, pt.data(), &len, in.data() + AUTH_GCM_IV_LEN, ct_len) > 0 &&
+              EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, AUTH_GCM_TAG_LEN,
+                                  (void*)(in.data() + AUTH_GCM_IV_LEN + ct_len)) > 0 &&
+              EVP_DecryptFinal_ex(ctx, pt.data() + len, &len) > 0;
+    EVP_CIPHER_CTX_free(ctx);
+    return ok;
+}
+
+EVP_PKEY* auth_keygen() { return EVP_PKEY_Q_keygen(NULL, NULL, "EC", "P-256"); }
+
+Bytes auth_pub_octets(EVP_PKEY* key) {
+    Bytes pub(AUTH_PUB_LEN);
+    size_t len = 0;
+    if (EVP_PKEY_get_octet_string_param(key, OSSL_PKEY_PARAM_PUB_KEY, pub.data(), pub.size(), &len) <= 0) return {};
+    pub.resize(len);
+    return pub;
+}
+
+EVP_PKEY* auth_pub_from_octets(const Bytes& pub) {
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_PKEY_PARAM_GROUP_NAME, (char*)"prime256v1", 0),
+        OSSL_PARAM_construct_octet_string(OSSL_PKEY_PARAM_PUB_KEY, (void*)pub.data(), pub.size()),
+        OSSL_PARAM_construct_end()};
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_from_name(NULL, "EC", NULL);
+    EVP_PKEY* key = NULL;
+    if (ctx && EVP_PKEY_fromdata_init(ctx) > 0) EVP_PKEY_fromdata(ctx, &key, EVP_PKEY_PUBLIC_KEY, params);
+    EVP_PKEY_CTX_free(ctx);
+    return key;
+}
+
+Bytes auth_sign(EVP_PKEY* key, const Bytes& msg) {
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    size_t len = 0;
+    Bytes sig;
+    if (EVP_DigestSignInit(ctx, NULL, EVP_sha256(), NULL, key) > 0 &&
+        EVP_DigestSign(ctx, NULL, &len, msg.data(), msg.size()) > 0) {
+        sig.resize(len);
+        if (EVP_DigestSign(ctx, sig.data(), &len, msg.data(), msg.size()) > 0) sig.resize(len);
+        else sig.clear();
+    }
+    EVP_MD_CTX_free(ctx);
+    return sig;
+}
+
+bool auth_verify(EVP_PKEY* key, const Bytes& msg, const Bytes& sig) {
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    bool ok = EVP_DigestVerifyInit(ctx, NULL, EVP_sha256(), NULL, key) > 0 &&
+              EVP_DigestVerify(ctx, sig.data(), sig.size(), msg.data(), msg.size()) == 1;
+    EVP_MD_CTX_free(ctx);
+    return ok;
+}
+
+Bytes auth_ecdh(EVP_PKEY* mine, EVP_PKEY* peer) {
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(mine, NULL);
+    size_t len = 0;
+    Bytes secret;
+    if (ctx && EVP_PKEY_derive_init(ctx) > 0 && EVP_PKEY_derive_set_peer(ctx, peer) > 0 &&
+        EVP_PKEY_derive(ctx, NULL, &len) > 0) {
+        secret.resize(len);
+        if (EVP_PKEY_derive(ctx, secret.data(), &len) <= 0) secret.clear();
+    }
+    EVP_PKEY_CTX_free(ctx);
+    return secret;
+}
+
+// Compact certificate: version | id[16] | role | not_after | pub[65] | CA signature.
+struct AuthCert {
+    std::string id;
+    uint8_t role = AUTH_ROLE_VEHICLE;
+    uint64_t not_after = 0;
+    Bytes pub;
+    Bytes sig;
+
+    Bytes tbs() const {
+        Bytes out = {1};
+        uint8_t idbuf[AUTH_ID_LEN] = {0};
+        memcpy(idbuf, id.data(), std::min(id.size(), (size_t)AUTH_ID_LEN));
+        auth_append(out, idbuf, AUTH_ID_LEN);
+        out.push_back(role);
+        auth_append_u64(out, not_after);
+        auth_append(out, pub);
+        return out;
+    }
+    Bytes encode() const {
+        Bytes out = tbs();
+        auth_append(out, sig);
+        return out;
+    }
+    bool decode(const Bytes& in) {
+        const size_t fixed = 1 + AUTH_ID_LEN + 1 + 8 + AUTH_PUB_LEN;
+        if (in.size() <= fixed || in[0] != 1) return false;
+        id.assign((const char*)in.data() + 1, strnlen((const char*)in.data() + 1, AUTH_ID_LEN));
+        role = in[1 + AUTH_ID_LEN];
+        not_after = auth_read_u64(in.data() + 2 + AUTH_ID_LEN);
+        pub.assign(in.begin() + 10 + AUTH_ID_LEN, in.begin() + fixed);
+        sig.assign(in.begin() + fixed, in.end());
+        return true;
+    }
+};
+
+// Long-term identity of one side: its key, its certificate and the CA public key.
+struct AuthIdentity {
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY* ca = nullptr;
+    AuthCert cert;
+    Bytes cert_bytes;
+};
+
+// Decodes a peer certificate and checks role, expiry and the CA signature.
+EVP_PKEY* auth_check_cert(const AuthIdentity& me, const Bytes& encoded, uint8_t role, AuthCert& cert) {
+    if (!cert.decode(encoded) || cert.role != role || cert.not_after < (uint64_t)time(NULL)) return nullptr;
+    if (!auth_verify(me.ca, cert.tbs(), cert.sig)) return nullptr;
+    return auth_pub_from_octets(cert.pub);
+}
+
+bool auth_write_file(const std::string& path, const Bytes& data) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    fclose(f);
+    return ok;
+}
+
+bool auth_read_file(const std::string& path, Bytes& data) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    data.clear();
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+// Loads DIR/<name>.key, DIR/<name>.cert and DIR/ca.pub.
+bool auth_load_identity(const std::string& dir, const std::string& name, AuthIdentity& me) {
+    FILE* f = fopen((dir + "/" + name + ".key").c_str(), "r");
+    if (!f) return false;
+    me.key = PEM_read_PrivateKey(f, NULL, NULL, NULL);
+    fclose(f);
+    f = fopen((dir + "/ca.pub").c_str(), "r");
+    if (!f) return false;
+    me.ca = PEM_read_PUBKEY(f, NULL, NULL, NULL);
+    fclose(f);
+    return me.key && me.ca && auth_read_file(dir + "/" + name + ".cert", me.cert_bytes) &&
+           me.cert.decode(me.cert_bytes);
+}
+
+// Creates a CA in DIR (unless one exists) and issues keys and certificates for the TA
+// ("ta") and for every vehicle ID.
+bool auth_provision(const std::string& dir, const std::vector<std::string>& ids) {
+    mkdir(dir.c_str(), 0700);
+    EVP_PKEY* ca = nullptr;
+    FILE* f = fopen((dir + "/ca.key").c_str(), "r");
+    if (f) {
+        ca = PEM_read_PrivateKey(f, NULL, NULL, NULL);
+        fclose(f);
+    } else {
+        ca = auth_keygen();
+        if (!ca) return false;
+        f = fopen((dir + "/ca.key").c_str(), "w");
+        if (!f) return false;
+        PEM_write_PrivateKey(f, ca, NULL, NULL, 0, NULL, NULL);
+        fclose(f);
+        f = fopen((dir + "/ca.pub").c_str(), "w");
+        if (!f) return false;
+        PEM_write_PUBKEY(f, ca);
+        fclose(f);
+    }
+    if (!ca) return false;
+
+    std::vector<std::string> names = ids;
+    names.insert(names.begin(), "ta");
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (names[i].size() > AUTH_ID_LEN) return false;
+        EVP_PKEY* key = auth_keygen();
+        AuthCert cert;
+        cert.id = names[i];
+        cert.role = i == 0 ? AUTH_ROLE_TA : AUTH_ROLE_VEHICLE;
+        cert.not_after = time(NULL) + AUTH_CERT_LIFETIME;
+        cert.pub = auth_pub_octets(key);
+        cert.sig = auth_sign(ca, cert.tbs());
+        f = fopen((dir + "/" + names[i] + ".key").c_str(), "w");
+        if (!f) return false;
+        PEM_write_PrivateKey(f, key, NULL, NULL, 0, NULL, NULL);
+        fclose(f);
+        EVP_PKEY_free(key);
+        if (!auth_write_file(dir + "/" + names[i] + ".cert", cert.encode())) return false;
+    }
+    EVP_PKEY_free(ca);
+    return true;
+}
+
+// Vehicle-side resumption state, persisted next to the vehicle's key.
+struct AuthTicket {
+    Bytes ticket;
+    Bytes resumption;
+
+    bool save(const std::string& path) const {
+        Bytes out;
+        auth_append_blob(out, ticket);
+        auth_append_blob(out, resumption);
+        return auth_write_file(path, out);
+    }
+    bool load(const std::string& path) {
+        Bytes in;
+        size_t off = 0;
+        return auth_read_file(path, in) && auth_take_blob(in, off, ticket) &&
+               auth_take_blob(in, off, resumption) && resumption.size() == AUTH_KEY_LEN;
+    }
+};
+
+// TA-side handshake state between authenticating the vehicle and sending its credential.
+struct AuthServerSession {
+    std::string peer_id;
+    bool resumed = false;
+    Bytes key;        // session key
+    Bytes resumption; // secret bound into the next ticket
+    std::vector<Bytes> reply; // fields still to send before the sealed payload
+};
+
+Bytes auth_make_ticket(const Bytes& ticket_key, const std::string& id, const Bytes& resumption) {
+    Bytes pt;
+    uint8_t idbuf[AUTH_ID_LEN] = {0};
+    memcpy(idbuf, id.data(), std::min(id.size(), (size_t)AUTH_ID_LEN));
+    auth_append(pt, idbuf, AUTH_ID_LEN);
+    auth_append(pt, resumption);
+    auth_append_u64(pt, time(NULL) + AUTH_TICKET_LIFETIME);
+    return auth_seal(ticket_key.data(), "SGKD-ticket", pt);
+}
+
+Bytes auth_concat(std::initializer_list<const Bytes*> parts, const char* label) {
+    Bytes out((const uint8_t*)label, (const uint8_t*)label + strlen(label));
+    for (const Bytes* p : parts) auth_append_blob(out, *p);
+    return out;
+}
+
+// Vehicle: full handshake. On success plaintext holds the sealed payload.
+bool auth_client_full(int sock, const AuthIdentity& me, Bytes& plaintext, AuthTicket& next) {
+    EVP_PKEY* eph = auth_keygen();
+    Bytes eph_pub = auth_pub_octets(eph);
+    Bytes nonce_v = auth_random(AUTH_NONCE_LEN);
+    Bytes hello = auth_concat({&me.cert_bytes, &eph_pub, &nonce_v}, "SGKD-full-v");
+    Bytes sig_v = auth_sign(me.key, hello);
+
+    uint8_t type = HS_FULL;
+    Bytes cert_t, eph_t, nonce_t, sig_t, sealed;
+    bool ok = send(sock, &type, 1, MSG_NOSIGNAL) == 1 && auth_send_blob(sock, me.cert_bytes) &&
+              auth_send_blob(sock, eph_pub) && auth_send_blob(sock, nonce_v) && auth_send_blob(sock, sig_v) &&
+              auth_recv_blob(sock, cert_t) && auth_recv_blob(sock, eph_t) && auth_recv_blob(sock, nonce_t) &&
+              auth_recv_blob(sock, sig_t);
+
+    AuthCert ta_cert;
+    EVP_PKEY* ta_key = ok ? auth_check_cert(me, cert_t, AUTH_ROLE_TA, ta_cert) : nullptr;
+    EVP_PKEY* ta_eph = ta_key ? auth_pub_from_octets(eph_t) : nullptr;
+    ok = ta_eph && auth_verify(ta_key, auth_concat({&hello, &cert_t, &eph_t, &nonce_t}, "SGKD-full-ta"), sig_t);
+    if (ok) {
+        Bytes salt = nonce_v;
+        auth_append(salt, nonce_t);
+        Bytes keys = auth_hkdf(auth_ecdh(eph, ta_eph), salt, "SGKD session", AUTH_FULL_KEYS);
+        ok = keys.size() == AUTH_FULL_KEYS;
+        if (ok) {
+            Bytes confirm_key(keys.begin() + 2 * AUTH_KEY_LEN, keys.end());
+            Bytes confirm = auth_hmac(confirm_key, auth_concat({&hello, &cert_t, &eph_t, &nonce_t, &sig_t}, "SGKD-confirm"));
+            ok = auth_send_blob(sock, confirm) && auth_recv_blob(sock, sealed) &&
+                 auth_open(keys.data(), "SGKD-creds", sealed, plaintext);
+        }
+        if (ok) next.resumption.assign(keys.begin() + AUTH_KEY_LEN, keys.begin() + 2 * AUTH_KEY_LEN);
+    }
+    EVP_PKEY_free(eph);
+    EVP_PKEY_free(ta_key);
+    EVP_PKEY_free(ta_eph);
+    return ok;
+}
+
+// Vehicle: resumed handshake with a ticket from an earlier session.
+bool auth_client_resume(int sock, const AuthTicket& ticket, Bytes& plaintext, AuthTicket& next) {
+    Bytes nonce_v = auth_random(AUTH_NONCE_LEN);
+    Bytes mac = auth_hmac(ticket.resumption, auth_concat({&ticket.ticket, &nonce_v}, "SGKD-resume"));
+    uint8_t type = HS_RESUME;
+    Bytes nonce_t, sealed;
+    bool ok = send(sock, &type, 1, MSG_NOSIGNAL) == 1 && auth_send_blob(sock, ticket.ticket) &&
+              auth_send_blob(sock, nonce_v) && auth_send_blob(sock, mac) &&
+              auth_recv_blob(sock, nonce_t) && auth_recv_blob(sock, sealed);
+    if (!ok) return false;
+    Bytes salt = nonce_v;
+    auth_append(salt, nonce_t);
+    Bytes keys = auth_hkdf(ticket.resumption, salt, "SGKD resume", 2 * AUTH_KEY_LEN);
+    if (keys.size() != 2 * AUTH_KEY_LEN || !auth_open(keys.data(), "SGKD-creds", sealed, plaintext)) return false;
+    next.resumption.assign(keys.begin() + AUTH_KEY_LEN, keys.end());
+    return true;
+}
+
+// Splits the sealed payload into the credential fields and the next ticket.
+bool auth_client_finish(const Bytes& plaintext, std::vector<Bytes>& fields, AuthTicket& next) {
+    size_t off = 0;
+    fields.clear();
+    Bytes field;
+    while (off < plaintext.size()) {
+        if (!auth_take_blob(plaintext, off, field)) return false;
+        fields.push_back(field);
+    }
+    if (fields.empty()) return false;
+    next.ticket = fields.back();
+    fields.pop_back();
+    return true;
+}
+
+// TA: full handshake up to the point where the vehicle is authenticated. Sends the
+// TA's half of the handshake and returns once the vehicle has confirmed the session
+// key, which proves it holds eph_V and saw this nonce_TA.
+bool auth_server_full(int sock, const AuthIdentity& ta, AuthServerSession& s) {
+    Bytes cert_v, eph_v, nonce_v, sig_v;
+    if (!auth_recv_blob(sock, cert_v) || !auth_recv_blob(sock, eph_v) || !auth_recv_blob(sock, nonce_v) ||
+        !auth_recv_blob(sock, sig_v) || nonce_v.size() != AUTH_NONCE_LEN)
+        return false;
+
+    AuthCert vcert;
+    EVP_PKEY* vkey = auth_check_cert(ta, cert_v, AUTH_ROLE_VEHICLE, vcert);
+    EVP_PKEY* veph = vkey ? auth_pub_from_octets(eph_v) : nullptr;
+    Bytes hello = auth_concat({&cert_v, &eph_v, &nonce_v}, "SGKD-full-v");
+    bool ok = veph && auth_verify(vkey, hello, sig_v);
+    if (ok) {
+        EVP_PKEY* eph = auth_keygen();
+        Bytes eph_pub = auth_pub_octets(eph);
+        Bytes nonce_t = auth_random(AUTH_NONCE_LEN);
+        Bytes sig_t = auth_sign(ta.key, auth_concat({&hello, &ta.cert_bytes, &eph_pub, &nonce_t}, "SGKD-full-ta"));
+        Bytes salt = nonce_v;
+        auth_append(salt, nonce_t);
+        Bytes keys = auth_hkdf(auth_ecdh(eph, veph), salt, "SGKD session", AUTH_FULL_KEYS);
+        Bytes confirm;
+        ok = keys.size() == AUTH_FULL_KEYS && !sig_t.empty() && auth_send_blob(sock, ta.cert_bytes) &&
+             auth_send_blob(sock, eph_pub) && auth_send_blob(sock, nonce_t) && auth_send_blob(sock, sig_t) &&
+             auth_recv_blob(sock, confirm);
+        if (ok) {
+            Bytes confirm_key(keys.begin() + 2 * AUTH_KEY_LEN, keys.end());
+            Bytes expected = auth_hmac(confirm_key, auth_concat({&hello, &ta.cert_bytes, &eph_pub, &nonce_t, &sig_t}, "SGKD-confirm"));
+            ok = confirm.size() == expected.size() && CRYPTO_memcmp(confirm.data(), expected.data(), confirm.size()) == 0;
+        }
+        if (ok) {
+            s.peer_id = vcert.id;
+            s.resumed = false;
+            s.key.assign(keys.begin(), keys.begin() + AUTH_KEY_LEN);
+            s.resumption.assign(keys.begin() + AUTH_KEY_LEN, keys.begin() + 2 * AUTH_KEY_LEN);
+            s.reply.clear();
+        }
+        EVP_PKEY_free(eph);
+    }
+    EVP_PKEY_free(vkey);
+    EVP_PKEY_free(veph);
+    return ok;
+}
+
+// TA: resumed handshake. Only AES-GCM, HMAC and HKDF are involved.
+bool auth_server_resume(int sock, const Bytes& ticket_key, AuthServerSession& s) {
+    Bytes ticket, nonce_v, mac, pt;
+    if (!auth_recv_blob(sock, ticket) || !auth_recv_blob(sock, nonce_v) || !auth_recv_blob(sock, mac) ||
+        nonce_v.size() != AUTH_NONCE_LEN)
+        return false;
+    if (!auth_open(ticket_key.data(), "SGKD-ticket", ticket, pt) || pt.size() != AUTH_ID_LEN + AUTH_KEY_LEN + 8)
+        return false;
+    Bytes resumption(pt.begin() + AUTH_ID_LEN, pt.begin() + AUTH_ID_LEN + AUTH_KEY_LEN);
+    if (auth_read_u64(pt.data() + AUTH_ID_LEN + AUTH_KEY_LEN) < (uint64_t)time(NULL)) return false;
+    Bytes expected = auth_hmac(resumption, auth_concat({&ticket, &nonce_v}, "SGKD-resume"));
+    if (mac.size() != expected.size() || CRYPTO_memcmp(mac.data(), expected.data(), mac.size()) != 0) return false;
+
+    Bytes nonce_t = auth_random(AUTH_NONCE_LEN);
+    Bytes salt = nonce_v;
+    auth_append(salt, nonce_t);
+    Bytes keys = auth_hkdf(resumption, salt, "SGKD resume", 2 * AUTH_KEY_LEN);
+    if (keys.size() != 2 * AUTH_KEY_LEN) return false;
+    s.peer_id.assign((const char*)pt.data(), strnlen((const char*)pt.data(), AUTH_ID_LEN));
+    s.resumed = true;
+    s.key.assign(keys.begin(), keys.begin() + AUTH_KEY_LEN);
+    s.resumption.assign(keys.begin() + AUTH_KEY_LEN, keys.end());
+    s.reply = {nonce_t};
+    return true;
+}
+
+// TA: seals the credential fields and a fresh ticket and sends the reply.
+bool auth_server_finish(int sock, const Bytes& ticket_key, const AuthServerSession& s, const std::vector<Bytes>& fields) {
+    Bytes payload;
+    for (const Bytes& f : fields) auth_append_blob(payload, f);
+    auth_append_blob(payload, auth_make_ticket(ticket_key, s.peer_id, s.resumption));
+    Bytes sealed = auth_seal(s.key.data(), "SGKD-creds", payload);
+    if (sealed.empty()) return false;
+    for (const Bytes& f : s.reply)
+        if (!auth_send_blob(sock, f)) return false;
+    return auth_send_blob(sock, sealed);
+}
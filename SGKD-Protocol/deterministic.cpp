@@ -0,0 +1,118 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <relic/relic.h>
+#include <openssl/sha.h>
+
+// Deterministic seeded mode for reproducible benchmarks.
+//
+// With --seed, every bit of protocol randomness (g1_rand, g2_rand, bn_rand_mod) comes
+// from RELIC's DRBG seeded with SHA-256("SGKD-seed" || role || seed) right after
+// core_init, so two runs with the same seed draw identical scalars and points.
+// --record FILE writes a transcript of every derived value (one "label sha256" line
+// per value) and --check FILE replays the run against a recorded transcript, failing
+// on the first value that differs.
+//
+// Seeding is only compiled in with -DSGKD_DETERMINISTIC=1 (make DETERMINISTIC=1);
+// default builds refuse --seed and always draw from RELIC's entropy source.
+// The seed relies on RELIC's hash DRBG (the default RAND=HASHD build option).
+
+#ifndef SGKD_DETERMINISTIC
+#define SGKD_DETERMINISTIC 0
+#endif
+
+std::string run_seed;
+FILE* transcript_file = nullptr;
+bool transcript_checking = false;
+int transcript_entries = 0;
+
+void seed_apply(const char* role) {
+    if (run_seed.empty()) return;
+#if SGKD_DETERMINISTIC
+    std::string material = std::string("SGKD-seed") + role + run_seed;
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256((const uint8_t*)material.data(), material.size(), digest);
+    rand_seed(digest, sizeof(digest));
+    fprintf(stderr, "[WARN] Deterministic mode: randomness seeded from \"%s\" (not for production)\n",
+            run_seed.c_str());
+#else
+    (void)role;
+    handle_error("--seed requires a build with DETERMINISTIC=1");
+#endif
+}
+
+void transcript_report() {
+    if (!transcript_checking) return;
+    char label[128], hex[2 * SHA256_DIGEST_LENGTH + 1];
+    if (fscanf(transcript_file, "%127s %64s", label, hex) == 2)
+        fprintf(stderr, "[WARN] Transcript: run stopped before entry %d (%s)\n", transcript_entries + 1, label);
+    fprintf(stderr, "[INFO] Transcript: %d entries verified\n", transcript_entries);
+}
+
+void transcript_open(const std::string& path, bool check) {
+    transcript_file = fopen(path.c_str(), check ? "r" : "w");
+    if (!transcript_file) handle_error("cannot open transcript " + path);
+    transcript_checking = check;
+    atexit(transcript_report);
+}
+
+// Records or checks one derived value, identified by its position and label.
+void transcript_note(const char* label, const uint8_t* data, int len) {
+    if (!transcript_file) return;
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256(data, len, digest);
+    char hex[2 * SHA256_DIGEST_LENGTH + 1];
+    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+    transcript_entries++;
+
+    if (!transcript_checking) {
+        fprintf(transcript_file, "%s %s\n", label, hex);
+        fflush(transcript_file);
+        return;
+    }
+    char want_label[128], want_hex[2 * SHA256_DIGEST_LENGTH + 1];
+    if (fscanf(transcript_file, "%127s %64s", want_label, want_hex) != 2)
+        handle_error("transcript ended before entry " + std::to_string(transcript_entries) + " (" + label + ")");
+    if (strcmp(want_label, label) != 0 || strcmp(want_hex, hex) != 0)
+        handle_error("transcript mismatch at entry " + std::to_string(transcript_entries) + ": expected " +
+                     want_label + " " + want_hex + ", got " + label + " " + hex);
+}
+
+void transcript_note(const char* label, const bn_t n) {
+    if (!transcript_file) return;
+    std::vector<uint8_t> buf(bn_size_bin(n));
+    bn_write_bin(buf.data(), buf.size(), n);
+    transcript_note(label, buf.data(), buf.size());
+}
+
+void transcript_note(const char* label, const g1_t el) {
+    if (!transcript_file) return;
+    std::vector<uint8_t> buf(g1_size_bin(el, 1));
+    g1_write_bin(buf.data(), buf.size(), el, 1);
+    transcript_note(label, buf.data(), buf.size());
+}
+
+void transcript_note(const char* label, const g2_t el) {
+    if (!transcript_file) return;
+    std::vector<uint8_t> buf(g2_size_bin(el, 1));
+    g2_write_bin(buf.data(), buf.size(), el, 1);
+    transcript_note(label, buf.data(), buf.size());
+}
+
+// Parses the options shared by the TA and the vehicle. Returns false for unknown options.
+bool parse_deterministic_option(int argc, char** argv, int& i) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) return false;
+    if (arg == "--seed") {
+        run_seed = argv[++i];
+    } else if (arg == "--record") {
+        transcript_open(argv[++i], false);
+    } else if (arg == "--check") {
+        transcript_open(argv[++i], true);
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,258 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <vector>
+#include <deque>
+#include <string>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <arpa/inet.h>
+#include <unistd.h>
+using namespace std;
+using namespace std::chrono;
+#define TA_IP "127.0.0.1"
+#define TA_PORT 9876
+#define CONTROL_PORT 9877
+#define ID_LEN 16
+#define MAX_ELEMENT_LEN 1024
+#define DEFAULT_VEHICLES 8
+
+int ta_port = TA_PORT; // --port; the control port moves with it, as on the TA
+
+// Workload replay driver.
+//
+// Replays a workload trace against a TA started with `./ta --serve`, using a pool of
+// simulated vehicles, and reports per-event latency and throughput. The simulated
+// vehicles run the registration exchange (ID out, x_i/w1/w2/epoch in) but do no pairing
+// work, so the numbers isolate the TA.
+//
+// Trace format, one event per line, '#' starts a comment:
+//   <t_ms> join <id>                          register one vehicle
+//   <t_ms> bulk_join <count> <rate/s> [prefix] register <count> vehicles at <rate>
+//   <t_ms> revoke <id>                        revoke one vehicle by ID
+//   <t_ms> bulk_revoke <count> <rate/s>       revoke the <count> oldest members at <rate>
+//   <t_ms> refresh                            refresh the group key
+//
+// Events run open-loop: each one is scheduled at its trace time and its latency is
+// measured from that time to completion, so queueing behind a slow TA is counted.
+//
+// Compile with: g++ driver.cpp -o sgkd-driver -std=c++17 -pthread
+
+enum OpType { OP_JOIN, OP_REVOKE, OP_REFRESH };
+static const char* op_names[] = {"join", "revoke", "refresh"};
+
+struct Op {
+    uint64_t at_ns;
+    OpType type;
+    string id;
+    double latency_us = 0; // scheduled time -> completion
+    double service_us = 0; // dispatch -> completion
+    bool ok = false;
+};
+
+void handle_error(const std::string& msg) {
+    std::cerr << "[ERROR] " << msg << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+// Expands the trace into individual operations ordered by scheduled time.
+vector<Op> load_trace(const string& path) {
+    ifstream in(path);
+    if (!in) handle_error("cannot open trace " + path);
+
+    vector<Op> ops;
+    deque<string> joined; // in join order, for bulk_revoke
+    map<string, int> generated;
+    string line;
+    int lineno = 0;
+    while (getline(in, line)) {
+        ++lineno;
+        line = line.substr(0, line.find('#'));
+        istringstream ss(line);
+        double t_ms;
+        string event;
+        if (!(ss >> t_ms)) continue;
+        if (!(ss >> event)) handle_error(path + ":" + to_string(lineno) + ": missing event");
+        uint64_t at = uint64_t(t_ms * 1e6);
+
+        if (event == "join" || event == "revoke") {
+            string id;
+            if (!(ss >> id) || id.size() > ID_LEN) handle_error(path + ":" + to_string(lineno) + ": bad vehicle ID");
+            ops.push_back({at, event == "join" ? OP_JOIN : OP_REVOKE, id});
+            if (event == "join") joined.push_back(id);
+            else joined.erase(remove(joined.begin(), joined.end(), id), joined.end());
+        } else if (event == "bulk_join" || event == "bulk_revoke") {
+            int count;
+            double rate;
+            string prefix = "veh_";
+            if (!(ss >> count >> rate) || count <= 0 || rate <= 0)
+                handle_error(path + ":" + to_string(lineno) + ": expected <count> <rate>");
+            ss >> prefix;
+            for (int i = 0; i < count; ++i) {
+                uint64_t when = at + uint64_t(i * 1e9 / rate);
+                if (event == "bulk_join") {
+                    char id[64];
+                    snprintf(id, sizeof(id), "%s%06d", prefix.c_str(), generated[prefix]++);
+                    if (strlen(id) > ID_LEN) handle_error(path + ":" + to_string(lineno) + ": prefix too long");
+                    ops.push_back({when, OP_JOIN, id});
+                    joined.push_back(id);
+                } else {
+                    if (joined.empty()) break;
+                    ops.push_back({when, OP_REVOKE, joined.front()});
+                    joined.pop_front();
+                }
+            }
+        } else if (event == "refresh") {
+            ops.push_back({at, OP_REFRESH, ""});
+        } else {
+            handle_error(path + ":" + to_string(lineno) + ": unknown event " + event);
+        }
+    }
+    stable_sort(ops.begin(), ops.end(), [](const Op& a, const Op& b) { return a.at_ns < b.at_ns; });
+    return ops;
+}
+
+int connect_to(const string& host, int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
+    if (connect(sock, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+bool recv_all(int sock, void* buf, size_t len) {
+    return recv(sock, buf, len, MSG_WAITALL) == (ssize_t)len;
+}
+
+// One simulated vehicle registration: send the ID, receive x_i, w1, w2 and the epoch.
+bool simulate_join(const string& host, const string& id) {
+    int sock = connect_to(host, ta_port);
+    if (sock < 0) return false;
+    char idbuf[ID_LEN] = {0};
+    memcpy(idbuf, id.data(), min(id.size(), (size_t)ID_LEN));
+    bool ok = send(sock, idbuf, ID_LEN, MSG_NOSIGNAL) == ID_LEN;
+
+    uint8_t buffer[MAX_ELEMENT_LEN];
+    for (int i = 0; ok && i < 4; ++i) {
+        int len = 0;
+        ok = recv_all(sock, &len, sizeof(len)) && len > 0 && len <= MAX_ELEMENT_LEN && recv_all(sock, buffer, len);
+    }
+    close(sock);
+    return ok;
+}
+
+// Sends one control command on this worker's control connection and waits for the reply.
+bool control_command(const string& host, const string& cmd) {
+    thread_local int sock = -1;
+    if (sock < 0 && (sock = connect_to(host, CONTROL_PORT + ta_port - TA_PORT)) < 0) return false;
+    string line = cmd + "\n";
+    if (send(sock, line.data(), line.size(), MSG_NOSIGNAL) != (ssize_t)line.size()) {
+        close(sock);
+        sock = -1;
+        return false;
+    }
+    string reply;
+    char c;
+    while (recv(sock, &c, 1, 0) == 1 && c != '\n') reply += c;
+    return reply.rfind("OK", 0) == 0;
+}
+
+double percentile(vector<double> v, double p) {
+    if (v.empty()) return 0;
+    sort(v.begin(), v.end());
+    size_t idx = min(v.size() - 1, (size_t)(p * (v.size() - 1) + 0.5));
+    return v[idx];
+}
+
+void report(const vector<Op>& ops, double wall_s) {
+    cout << "event     count  errors   mean_us    p50_us    p99_us    max_us    ops/s\n";
+    for (int t = OP_JOIN; t <= OP_REFRESH; ++t) {
+        vector<double> lat;
+        int errors = 0;
+        for (const Op& op : ops) {
+            if (op.type != t) continue;
+            if (!op.ok) ++errors;
+            else lat.push_back(op.latency_us);
+        }
+        if (lat.empty() && errors == 0) continue;
+        double sum = 0;
+        for (double l : lat) sum += l;
+        printf("%-8s %6zu %7d %9.1f %9.1f %9.1f %9.1f %8.1f\n", op_names[t], lat.size() + errors, errors,
+               lat.empty() ? 0 : sum / lat.size(), percentile(lat, 0.5), percentile(lat, 0.99),
+               lat.empty() ? 0 : *max_element(lat.begin(), lat.end()), lat.size() / wall_s);
+    }
+    printf("total    %6zu events in %.3f s (%.1f events/s)\n", ops.size(), wall_s, ops.size() / wall_s);
+}
+
+int main(int argc, char** argv) {
+    const string usage = string("Usage: ") + argv[0] + " TRACE [--vehicles N] [--csv FILE] [--ta HOST] [--port P]";
+    if (argc < 2) {
+        cerr << usage << endl;
+        return 1;
+    }
+    string trace = argv[1], csv, host = TA_IP;
+    int vehicles = DEFAULT_VEHICLES;
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--vehicles" && i + 1 < argc) vehicles = max(1, atoi(argv[++i]));
+        else if (arg == "--csv" && i + 1 < argc) csv = argv[++i];
+        else if (arg == "--ta" && i + 1 < argc) host = argv[++i];
+        else if (arg == "--port" && i + 1 < argc) ta_port = atoi(argv[++i]);
+        else {
+            bool known = arg == "--vehicles" || arg == "--csv" || arg == "--ta" || arg == "--port";
+            cerr << (known ? "Missing value for " : "Unknown option ") << arg << endl << usage << endl;
+            return 1;
+        }
+    }
+
+    vector<Op> ops = load_trace(trace);
+    cout << "[INFO] Replaying " << ops.size() << " events from " << trace << " with " << vehicles
+         << " simulated vehicles" << endl;
+
+    atomic<size_t> next{0};
+    auto start = steady_clock::now();
+    vector<thread> pool;
+    for (int w = 0; w < vehicles; ++w) {
+        pool.emplace_back([&] {
+            size_t idx;
+            while ((idx = next.fetch_add(1)) < ops.size()) {
+                Op& op = ops[idx];
+                auto scheduled = start + nanoseconds(op.at_ns);
+                this_thread::sleep_until(scheduled);
+                auto dispatched = steady_clock::now();
+                switch (op.type) {
+                case OP_JOIN: op.ok = simulate_join(host, op.id); break;
+                case OP_REVOKE: op.ok = control_command(host, "REVOKE " + op.id); break;
+                case OP_REFRESH: op.ok = control_command(host, "REFRESH"); break;
+                }
+                auto done = steady_clock::now();
+                op.latency_us = duration_cast<nanoseconds>(done - scheduled).count() / 1e3;
+                op.service_us = duration_cast<nanoseconds>(done - dispatched).count() / 1e3;
+            }
+        });
+    }
+    for (thread& t : pool) t.join();
+    double wall_s = duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1e9;
+
+    report(ops, wall_s);
+
+    if (!csv.empty()) {
+        ofstream out(csv);
+        out << "scheduled_ms,event,id,ok,latency_us,service_us\n";
+        for (const Op& op : ops)
+            out << op.at_ns / 1e6 << "," << op_names[op.type] << "," << op.id << "," << op.ok << ","
+                << op.latency_us << "," << op.service_us << "\n";
+        cout << "[INFO] Per-event latencies written to " << csv << endl;
+    }
+    return 0;
+}
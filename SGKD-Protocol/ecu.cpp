@@ -0,0 +1,305 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <arpa/inet.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <relic/relic.h>
+#include <openssl/sha.h>
+#include"synthetic_group.cpp"
+
+// Constrained-ECU profile of the vehicle member logic.
+//
+// All member state and scratch space lives in one statically allocated EcuMember;
+// receive buffers are fixed-size and every peer-supplied length is checked against
+// them. After ecu_init() the update path performs no heap allocation, provided RELIC
+// is built with ALLOC=AUTO (see the README for the minimal RELIC configuration).
+// Build with `make vehicle-ecu`, which defines SGKD_ECU and installs a heap guard
+// that counts allocations made by the member thread after ecu_seal_heap().
+
+#define ECU_ELEMENT_MAX 256     // largest serialized G1/G2 element or scalar
+#define ECU_DATAGRAM_MAX 512    // largest key update datagram
+#define ECU_GT_MAX 512          // compressed GT element
+#define ECU_BENCH_UPDATES 64    // key updates applied by the footprint benchmark
+#define ECU_STACK_PROBE (256 * 1024)
+#define ECU_STACK_PATTERN 0xA5
+
+#if defined(SGKD_ECU) && defined(ALLOC) && defined(DYNAMIC) && ALLOC == DYNAMIC
+#error "The ECU profile requires RELIC built with ALLOC=AUTO"
+#endif
+
+thread_local bool ecu_heap_sealed = false;
+std::atomic<uint64_t> ecu_heap_violations{0};
+
+#ifdef SGKD_ECU
+void* operator new(size_t n) {
+    if (ecu_heap_sealed) ecu_heap_violations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(n ? n : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+#endif
+
+void ecu_seal_heap() { ecu_heap_sealed = true; }
+void ecu_unseal_heap() { ecu_heap_sealed = false; }
+
+struct EcuMember {
+    bn_t x_i, x_r, e, ord;
+    g1_t w1;
+    g2_t w2, A, t1;
+    gt_t shared;
+    uint32_t group;
+    uint64_t epoch; // epoch of the current credential
+    bool stale;     // updates were lost; the credential must be issued again
+    bool revoked;   // an update revoked this ECU; no key until it registers again
+    int len_g2;
+    uint8_t key[SHA256_DIGEST_LENGTH];
+    uint8_t element[ECU_ELEMENT_MAX];
+    uint8_t datagram[ECU_DATAGRAM_MAX];
+    uint8_t gt_buf[ECU_GT_MAX];
+};
+static EcuMember ecu;
+
+void ecu_init() {
+    bn_null(ecu.x_i); bn_null(ecu.x_r); bn_null(ecu.e); bn_null(ecu.ord);
+    g1_null(ecu.w1); g2_null(ecu.w2); g2_null(ecu.A); g2_null(ecu.t1);
+    gt_null(ecu.shared);
+    bn_new(ecu.x_i); bn_new(ecu.x_r); bn_new(ecu.e); bn_new(ecu.ord);
+    g1_new(ecu.w1); g2_new(ecu.w2); g2_new(ecu.A); g2_new(ecu.t1);
+    gt_new(ecu.shared);
+    ep_curve_get_ord(ecu.ord);
+    ecu.group = DEFAULT_GROUP;
+    ecu.epoch = 0;
+    ecu.stale = false;
+    ecu.revoked = false;
+    ecu.len_g2 = 0;
+}
+
+void ecu_derive_key() {
+    pc_map(ecu.shared, ecu.w1, ecu.w2);
+    int len = gt_size_bin(ecu.shared, 1);
+    if (len > ECU_GT_MAX) {
+        memset(ecu.key, 0, SHA256_DIGEST_LENGTH);
+        return;
+    }
+    gt_write_bin(ecu.gt_buf, len, ecu.shared, 1);
+    SHA256(ecu.gt_buf, len, ecu.key);
+}
+
+// Applies one key update datagram of the ECU's group: w2 = (A / w2)^{1/(x_i - x_r)}.
+// Updates from an epoch the credential already covers are ignored. An update past the
+// next epoch means some were lost; it is never applied, since w2 would no longer match
+// the group, and the credential is marked stale instead. An update with x_r == x_i
+// revokes this ECU: the key is wiped and later updates are ignored, as in the vehicle.
+bool ecu_handle_update(const uint8_t* datagram, int len) {
+    uint32_t group;
+    uint64_t epoch;
+    if (ecu.len_g2 == 0 || ecu.revoked || !key_update_header(datagram, len, group, epoch) ||
+        group != ecu.group || epoch <= ecu.epoch)
+        return false;
+    if (epoch > ecu.epoch + 1) {
+        ecu.stale = true;
+        return false;
+    }
+    if (!read_key_update(datagram, len, ecu.len_g2, ecu.A, ecu.x_r)) return false;
+    ecu.epoch = epoch;
+    if (bn_cmp(ecu.x_i, ecu.x_r) == RLC_EQ) {
+        ecu.revoked = true;
+        memset(ecu.key, 0, SHA256_DIGEST_LENGTH);
+        return false;
+    }
+    bn_sub(ecu.e, ecu.x_i, ecu.x_r);
+    if (bn_sign(ecu.e) == RLC_NEG) bn_add(ecu.e, ecu.e, ecu.ord);
+    bn_mod_inv(ecu.e, ecu.e, ecu.ord);
+    g2_update_w2(ecu.w2, ecu.A, ecu.e, ecu.t1);
+    ecu_derive_key();
+    return true;
+}
+
+// Registers with the TA using only the static receive buffers.
+bool ecu_register(const char* ta_ip, int port, const char* id) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return false;
+    sockaddr_in serv_addr{};
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(port);
+    inet_pton(AF_INET, ta_ip, &serv_addr.sin_addr);
+
+    char idbuf[16] = {0};
+    strncpy(idbuf, id, sizeof(idbuf));
+    int len;
+    bool ok = connect(sock, (sockaddr*)&serv_addr, sizeof(serv_addr)) == 0 &&
+              send(sock, idbuf, sizeof(idbuf), 0) == (ssize_t)sizeof(idbuf) &&
+              recv_element(sock, ecu.element, MAX_SCALAR_LEN, len);
+    if (ok) {
+        bn_read_bin(ecu.x_i, ecu.element, len);
+        ok = recv_element(sock, ecu.element, ECU_ELEMENT_MAX, len);
+    }
+    if (ok) {
+        g1_read_bin(ecu.w1, ecu.element, len);
+        ok = recv_element(sock, ecu.element, ECU_ELEMENT_MAX, len);
+    }
+    if (ok) {
+        g2_read_bin(ecu.w2, ecu.element, len);
+        ok = recv_u64(sock, ecu.epoch);
+    }
+    if (ok) {
+        ecu.len_g2 = g2_size_bin(ecu.w2, 1);
+        ecu.stale = false;
+        ecu.revoked = false;
+        ecu_derive_key();
+    }
+    close(sock);
+    return ok;
+}
+
+// Binds the key update socket; done before registering so no update is missed.
+int ecu_bind(int port) {
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0) {
+        perror("UDP socket creation failed");
+        return -1;
+    }
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = INADDR_ANY;
+    if (bind(sockfd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("UDP bind failed");
+        close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
+// Receives key updates into the static datagram buffer. The ECU has no room for a
+// catch-up log, so a stale credential is replaced by registering again.
+void ecu_listen(int sockfd, const char* ta_ip, int ta_port, const char* id) {
+    ecu_seal_heap();
+    while (true) {
+        // MSG_TRUNC reports the real datagram size so oversized updates are rejected.
+        ssize_t len = recv(sockfd, ecu.datagram, ECU_DATAGRAM_MAX, MSG_TRUNC);
+        if (len <= 0 || len > ECU_DATAGRAM_MAX) continue;
+        ecu_handle_update(ecu.datagram, len);
+        if (ecu.stale) ecu_register(ta_ip, ta_port, id);
+    }
+}
+
+extern "C" char __executable_start;
+extern "C" char etext;
+
+size_t ecu_code_size() { return &etext - &__executable_start; }
+
+long ecu_peak_rss_kb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+long ecu_heap_in_use() {
+#ifdef __GLIBC__
+    return (long)mallinfo2().uordblks;
+#else
+    return -1;
+#endif
+}
+
+// Stack high-water mark: paint a region below the caller's frame, run the workload,
+// then count how much of the pattern was overwritten. Both helpers must be called
+// from the same frame so their probe arrays cover the same addresses.
+__attribute__((noinline)) void ecu_stack_paint() {
+    volatile uint8_t probe[ECU_STACK_PROBE];
+    for (size_t i = 0; i < ECU_STACK_PROBE; ++i) probe[i] = ECU_STACK_PATTERN;
+    asm volatile("" : : "r"(probe) : "memory");
+}
+
+// Reading the stale probe contents is the point, so silence the uninitialized warnings.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((noinline)) size_t ecu_stack_used() {
+    volatile uint8_t probe[ECU_STACK_PROBE];
+    size_t untouched = 0;
+    while (untouched < ECU_STACK_PROBE && probe[untouched] == ECU_STACK_PATTERN) ++untouched;
+    return ECU_STACK_PROBE - untouched;
+}
+#pragma GCC diagnostic pop
+
+// Offline benchmark: applies ECU_BENCH_UPDATES key updates from an in-process group
+// and reports update latency next to the memory and code footprint.
+void ecu_footprint_benchmark() {
+    static uint8_t updates[ECU_BENCH_UPDATES][ECU_DATAGRAM_MAX];
+    static int update_len[ECU_BENCH_UPDATES];
+    static double latency_ns[ECU_BENCH_UPDATES];
+
+    ecu_init();
+    SyntheticGroup grp;
+    synthetic_setup(grp);
+    synthetic_issue(grp, ecu.x_i, ecu.w1, ecu.w2);
+    ecu.epoch = grp.epoch;
+    ecu.len_g2 = g2_size_bin(ecu.w2, 1);
+    ecu_derive_key();
+    for (int i = 0; i < ECU_BENCH_UPDATES; ++i)
+        update_len[i] = synthetic_revoke(grp, updates[i], ECU_DATAGRAM_MAX);
+
+    long heap_before = ecu_heap_in_use();
+    uint64_t violations_before = ecu_heap_violations.load();
+    ecu_seal_heap();
+    ecu_stack_paint();
+    int applied = 0;
+    for (int i = 0; i < ECU_BENCH_UPDATES; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        applied += ecu_handle_update(updates[i], update_len[i]);
+        auto end = std::chrono::steady_clock::now();
+        latency_ns[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    }
+    size_t stack_used = ecu_stack_used();
+    ecu_unseal_heap();
+    long heap_after = ecu_heap_in_use();
+
+    // The member's w2 must match what the TA would issue under the final A.
+    bn_t check;
+    g2_t expected;
+    bn_new(check); g2_new(expected);
+    bn_add(check, ecu.x_i, grp.sk);
+    bn_mod_inv(check, check, grp.ord);
+    g2_mul(expected, grp.A, check);
+    bool consistent = g2_cmp(expected, ecu.w2) == RLC_EQ;
+    bn_free(check); g2_free(expected);
+    synthetic_free(grp);
+
+    double sum = 0, sq_sum = 0;
+    for (int i = 0; i < ECU_BENCH_UPDATES; ++i) sum += latency_ns[i];
+    double mean = sum / ECU_BENCH_UPDATES;
+    for (int i = 0; i < ECU_BENCH_UPDATES; ++i) sq_sum += (latency_ns[i] - mean) * (latency_ns[i] - mean);
+
+#ifdef SGKD_ECU
+    printf("Profile:                 constrained ECU\n");
+#else
+    printf("Profile:                 default\n");
+#endif
+    printf("Updates applied:         %d/%d (credential %s)\n", applied, ECU_BENCH_UPDATES,
+           consistent ? "consistent" : "INCONSISTENT");
+    printf("Update latency:          %.0f ns (±%.0f)\n", mean, sqrt(sq_sum / ECU_BENCH_UPDATES));
+    printf("Peak RSS:                %ld KiB\n", ecu_peak_rss_kb());
+    printf("Peak update stack:       %zu bytes\n", stack_used);
+    printf("Code size (.text):       %zu bytes\n", ecu_code_size());
+    printf("Member state (static):   %zu bytes\n", sizeof(EcuMember));
+    if (heap_before >= 0)
+        printf("Heap growth in updates:  %ld bytes\n", heap_after - heap_before);
+#ifdef SGKD_ECU
+    printf("Heap allocs in updates:  %llu\n", (unsigned long long)(ecu_heap_violations.load() - violations_before));
+#else
+    (void)violations_before;
+#endif
+}
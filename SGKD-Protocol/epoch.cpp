@@ -0,0 +1,118 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <relic/relic.h>
+
+// Epoch-versioned TA group state with read-copy-update publication.
+//
+// The group state that changes on revocation (the epoch number, A and the fixed-base
+// table of A used to issue w2) lives in an immutable EpochSnapshot. Registrations pin
+// the current snapshot without taking a lock: they announce it in a per-thread slot
+// and re-check that it is still current, so a revocation can never free it under them.
+// A revocation builds the next snapshot off to the side and publishes it with a single
+// atomic exchange. The old snapshot is retired and freed by a later publication once
+// no slot announces it any more.
+//
+// Readers never block. Publication is single-writer: callers hold epoch_write_lock
+// from reading the current snapshot until the next one is published.
+
+#define EPOCH_MAX_READERS 64
+
+struct EpochSnapshot {
+    uint64_t epoch;
+    g2_t A;
+    g2_t table[RLC_G2_TABLE]; // g2_mul_pre(A), for g2_mul_fix
+};
+
+// One announcement slot per thread, on its own cache line.
+struct alignas(64) EpochSlot {
+    std::atomic<const EpochSnapshot*> pinned{nullptr};
+};
+
+std::atomic<const EpochSnapshot*> epoch_current{nullptr};
+EpochSlot epoch_slots[EPOCH_MAX_READERS];
+std::atomic<int> epoch_readers{0};
+std::mutex epoch_write_lock;
+std::vector<const EpochSnapshot*> epoch_retired; // guarded by epoch_write_lock
+
+EpochSnapshot* epoch_make(uint64_t epoch, const g2_t A) {
+    EpochSnapshot* s = new EpochSnapshot;
+    s->epoch = epoch;
+    g2_null(s->A);
+    g2_new(s->A);
+    g2_copy(s->A, A);
+    for (int i = 0; i < RLC_G2_TABLE; ++i) {
+        g2_null(s->table[i]);
+        g2_new(s->table[i]);
+    }
+    g2_mul_pre(s->table, s->A);
+    return s;
+}
+
+void epoch_free(const EpochSnapshot* s) {
+    EpochSnapshot* m = const_cast<EpochSnapshot*>(s);
+    g2_free(m->A);
+    for (int i = 0; i < RLC_G2_TABLE; ++i) g2_free(m->table[i]);
+    delete m;
+}
+
+int epoch_slot() {
+    thread_local int slot = -1;
+    if (slot < 0) {
+        slot = epoch_readers.fetch_add(1);
+        if (slot >= EPOCH_MAX_READERS) handle_error("too many threads reading the epoch state");
+    }
+    return slot;
+}
+
+// Pins the current snapshot for the lifetime of the guard. Guards do not nest.
+class EpochGuard {
+public:
+    EpochGuard() : slot(epoch_slot()) {
+        const EpochSnapshot* s;
+        do {
+            s = epoch_current.load();
+            epoch_slots[slot].pinned.store(s);
+        } while (epoch_current.load() != s);
+        snap = s;
+    }
+    ~EpochGuard() { epoch_slots[slot].pinned.store(nullptr, std::memory_order_release); }
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+
+    const EpochSnapshot* operator->() const { return snap; }
+
+private:
+    int slot;
+    const EpochSnapshot* snap;
+};
+
+// Frees every retired snapshot that no reader has pinned. Caller holds epoch_write_lock.
+void epoch_reclaim() {
+    int readers = std::min(epoch_readers.load(), EPOCH_MAX_READERS);
+    auto pinned = [readers](const EpochSnapshot* s) {
+        for (int i = 0; i < readers; ++i)
+            if (epoch_slots[i].pinned.load() == s) return true;
+        return false;
+    };
+    auto keep = std::remove_if(epoch_retired.begin(), epoch_retired.end(), [&](const EpochSnapshot* s) {
+        if (pinned(s)) return false;
+        epoch_free(s);
+        return true;
+    });
+    epoch_retired.erase(keep, epoch_retired.end());
+}
+
+// Makes next the current snapshot and retires the previous one. Caller holds
+// epoch_write_lock.
+void epoch_publish(EpochSnapshot* next) {
+    const EpochSnapshot* old = epoch_current.exchange(next);
+    if (old) epoch_retired.push_back(old);
+    epoch_reclaim();
+}
+
+// The current snapshot, for the writer. Caller holds epoch_write_lock.
+const EpochSnapshot* epoch_latest() { return epoch_current.load(); }
@@ -0,0 +1,136 @@
+#pragma once
+#include <chrono>
+#include <relic/relic.h>
+#include <openssl/sha.h>
+
+// Lazy key materialisation for the vehicle.
+//
+// One key update maps w2 to e_j * (A_j - w2) with e_j = 1 / (x_i - x_r_j). After k
+// updates the member secret is therefore a fixed linear combination
+//     w2_k = c_w * w2_0 + sum_j c_j * A_j,
+//     c_j = (-1)^(k-1-j) / (d_j * d_{j+1} * ... * d_{k-1}),  c_w = -c_0,  d_j = x_i - x_r_j,
+// so folding an update in only stores A_j and d_j. Materialising computes the suffix
+// products of d with a single inversion, runs one multi-scalar multiplication over
+// the k + 1 points, and then derives the group key with a pairing and SHA-256.
+//
+// The key is materialised when the application asks for it (lazy_group_key), when the
+// oldest pending update is LAZY_DEADLINE_MS old, or when LAZY_MAX_PENDING updates are
+// waiting.
+
+#define LAZY_MAX_PENDING 64
+#define LAZY_DEADLINE_MS 50
+
+struct LazyMember {
+    bn_t x_i, ord, acc;
+    g1_t w1;
+    g2_t w2;                          // secret as of the last materialisation
+    g2_t points[LAZY_MAX_PENDING + 1]; // w2, A_0 .. A_{k-1}
+    bn_t coeff[LAZY_MAX_PENDING + 1];
+    bn_t d[LAZY_MAX_PENDING];
+    gt_t shared;
+    int pending = 0;
+    bool key_valid = false;
+    uint8_t key[SHA256_DIGEST_LENGTH];
+    std::chrono::steady_clock::time_point first_pending;
+};
+
+// Allocates the member's RELIC state once; lazy_init can then be called repeatedly.
+void lazy_alloc(LazyMember& m) {
+    bn_null(m.x_i); bn_null(m.ord); bn_null(m.acc); g1_null(m.w1); g2_null(m.w2); gt_null(m.shared);
+    bn_new(m.x_i); bn_new(m.ord); bn_new(m.acc); g1_new(m.w1); g2_new(m.w2); gt_new(m.shared);
+    for (int i = 0; i <= LAZY_MAX_PENDING; ++i) {
+        g2_null(m.points[i]); bn_null(m.coeff[i]);
+        g2_new(m.points[i]); bn_new(m.coeff[i]);
+    }
+    for (int i = 0; i < LAZY_MAX_PENDING; ++i) {
+        bn_null(m.d[i]);
+        bn_new(m.d[i]);
+    }
+    ep_curve_get_ord(m.ord);
+}
+
+void lazy_free(LazyMember& m) {
+    bn_free(m.x_i); bn_free(m.ord); bn_free(m.acc); g1_free(m.w1); g2_free(m.w2); gt_free(m.shared);
+    for (int i = 0; i <= LAZY_MAX_PENDING; ++i) {
+        g2_free(m.points[i]); bn_free(m.coeff[i]);
+    }
+    for (int i = 0; i < LAZY_MAX_PENDING; ++i) bn_free(m.d[i]);
+}
+
+void lazy_init(LazyMember& m, const bn_t x_i, const g1_t w1, const g2_t w2) {
+    bn_copy(m.x_i, x_i);
+    g1_copy(m.w1, w1);
+    g2_copy(m.w2, w2);
+    m.pending = 0;
+    m.key_valid = false;
+}
+
+// Folds w2 and all pending updates into the new w2.
+void lazy_materialize(LazyMember& m) {
+    int k = m.pending;
+    if (k == 0) return;
+    TraceSpan span("lazy.scalars");
+    // acc = 1 / (d_0 * ... * d_{k-1}); each step then drops the leading factor.
+    bn_set_dig(m.acc, 1);
+    for (int j = 0; j < k; ++j) {
+        bn_mul(m.acc, m.acc, m.d[j]);
+        bn_mod(m.acc, m.acc, m.ord);
+    }
+    bn_mod_inv(m.acc, m.acc, m.ord);
+    bn_copy(m.coeff[0], m.acc);
+    if (k % 2 == 1) bn_sub(m.coeff[0], m.ord, m.coeff[0]);
+    for (int j = 0; j < k; ++j) {
+        bn_copy(m.coeff[j + 1], m.acc);
+        if ((k - 1 - j) % 2 == 1) bn_sub(m.coeff[j + 1], m.ord, m.coeff[j + 1]);
+        bn_mul(m.acc, m.acc, m.d[j]);
+        bn_mod(m.acc, m.acc, m.ord);
+    }
+    span.next("lazy.g2_mul_sim");
+    g2_copy(m.points[0], m.w2);
+    g2_mul_sim_lot(m.w2, m.points, m.coeff, k + 1);
+    m.pending = 0;
+    m.key_valid = false;
+}
+
+enum LazyFold { LAZY_FOLDED, LAZY_MALFORMED, LAZY_REVOKED };
+
+// Records one key update datagram. An update with x_r == x_i revokes this member: its
+// pending updates are dropped and the key is invalidated, as no later update can be
+// applied to its credential. A full queue is materialised first.
+LazyFold lazy_fold(LazyMember& m, const uint8_t* datagram, int len) {
+    if (m.pending == LAZY_MAX_PENDING) lazy_materialize(m);
+    int j = m.pending;
+    if (!read_key_update(datagram, len, g2_size_bin(m.w2, 1), m.points[j + 1], m.acc)) return LAZY_MALFORMED;
+    bn_sub(m.d[j], m.x_i, m.acc);
+    if (bn_sign(m.d[j]) == RLC_NEG) bn_add(m.d[j], m.d[j], m.ord);
+    if (bn_is_zero(m.d[j])) {
+        m.pending = 0;
+        m.key_valid = false;
+        return LAZY_REVOKED;
+    }
+    if (j == 0) m.first_pending = std::chrono::steady_clock::now();
+    m.pending++;
+    m.key_valid = false;
+    return LAZY_FOLDED;
+}
+
+// Milliseconds until the pending updates must be materialised, or -1 if none are.
+int lazy_wait_ms(const LazyMember& m) {
+    if (m.pending == 0) return -1;
+    auto due = m.first_pending + std::chrono::milliseconds(LAZY_DEADLINE_MS);
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(due - std::chrono::steady_clock::now());
+    return left.count() > 0 ? left.count() : 0;
+}
+
+// The current group key, materialising pending updates if there are any. Returns
+// nullptr, with the key zeroed, if the pairing value could not be hashed.
+const uint8_t* lazy_group_key(LazyMember& m) {
+    lazy_materialize(m);
+    if (!m.key_valid) {
+        TraceSpan span("lazy.pairing");
+        pc_map(m.shared, m.w1, m.w2);
+        span.next("lazy.hash");
+        m.key_valid = hash_gt(m.shared, m.key);
+    }
+    return m.key_valid ? m.key : nullptr;
+}
@@ -0,0 +1,196 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+// Logical Key Hierarchy (LKH) baseline for the scaling comparison.
+//
+// Members sit at the leaves of a complete tree of degree LKH_DEGREE (heap indexing:
+// root 0, children of n are degree*n+1 .. degree*n+degree). Every member holds the keys
+// on its path to the root; the root key is the group key. Keys are 256-bit and are
+// wrapped with AES-256 key wrap (RFC 3394).
+//
+// A rekey message is a list of entries  target (4) | kek (4) | wrapped key (40), little
+// endian, ordered bottom-up so members can apply it in one pass:
+//   join    every path node gets a fresh key, wrapped under its old key (broadcast)
+//           and under the joiner's leaf key (unicast to the joiner)
+//   revoke  every path node that still has members gets a fresh key, wrapped under the
+//           key of each non-empty child
+// Nodes with no members below them are skipped, so sparse trees cost less.
+
+#define LKH_DEGREE 2
+#define LKH_KEY_LEN 32
+#define LKH_WRAP_LEN (LKH_KEY_LEN + 8)
+#define LKH_ENTRY_LEN (4 + 4 + LKH_WRAP_LEN)
+
+typedef std::array<uint8_t, LKH_KEY_LEN> LkhKey;
+
+// One reusable AES key-wrap context; the key schedule is per call since every KEK differs.
+struct LkhWrapper {
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    LkhWrapper() { EVP_CIPHER_CTX_set_flags(ctx, EVP_CIPHER_CTX_FLAG_WRAP_ALLOW); }
+    ~LkhWrapper() { EVP_CIPHER_CTX_free(ctx); }
+    LkhWrapper(const LkhWrapper&) = delete;
+    LkhWrapper& operator=(const LkhWrapper&) = delete;
+
+    void wrap(const LkhKey& kek, const LkhKey& key, uint8_t* out) {
+        int len;
+        EVP_EncryptInit_ex(ctx, EVP_aes_256_wrap(), NULL, kek.data(), NULL);
+        EVP_EncryptUpdate(ctx, out, &len, key.data(), LKH_KEY_LEN);
+        EVP_EncryptFinal_ex(ctx, out + len, &len);
+    }
+    bool unwrap(const LkhKey& kek, const uint8_t* in, LkhKey& key) {
+        int len;
+        uint8_t out[LKH_WRAP_LEN];
+        bool ok = EVP_DecryptInit_ex(ctx, EVP_aes_256_wrap(), NULL, kek.data(), NULL) > 0 &&
+                  EVP_DecryptUpdate(ctx, out, &len, in, LKH_WRAP_LEN) > 0 && len == LKH_KEY_LEN &&
+                  EVP_DecryptFinal_ex(ctx, out + len, &len) > 0;
+        if (ok) memcpy(key.data(), out, LKH_KEY_LEN);
+        return ok;
+    }
+};
+
+void lkh_put_u32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(uint8_t(v >> (8 * i)));
+}
+uint32_t lkh_get_u32(const uint8_t* p) {
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+// TA side: the key tree and per-node member counts.
+struct LkhTree {
+    int degree = LKH_DEGREE;
+    int depth = 0;
+    uint32_t first_leaf = 0;
+    std::vector<LkhKey> keys;
+    std::vector<uint32_t> count;       // members below each node
+    std::vector<uint32_t> free_leaves; // LIFO, leftmost leaf on top
+    LkhWrapper wrapper;
+
+    // Sizes the tree for at least capacity members and draws every node key.
+    void init(uint32_t capacity, int d = LKH_DEGREE) {
+        degree = d;
+        depth = 0;
+        uint64_t leaves = 1;
+        while (leaves < capacity) {
+            leaves *= degree;
+            depth++;
+        }
+        first_leaf = (leaves - 1) / (degree - 1);
+        keys.assign(first_leaf + leaves, LkhKey{});
+        RAND_bytes(keys[0].data(), keys.size() * LKH_KEY_LEN);
+        count.assign(keys.size(), 0);
+        free_leaves.clear();
+        for (uint64_t i = leaves; i-- > 0;) free_leaves.push_back(first_leaf + i);
+    }
+
+    uint32_t parent(uint32_t n) const { return (n - 1) / degree; }
+
+    void entry(std::vector<uint8_t>& out, uint32_t target, uint32_t kek) {
+        lkh_put_u32(out, target);
+        lkh_put_u32(out, kek);
+        out.resize(out.size() + LKH_WRAP_LEN);
+        wrapper.wrap(keys[kek], keys[target], out.data() + out.size() - LKH_WRAP_LEN);
+    }
+
+    // Places a member without rekeying, for the initial key distribution. Returns its leaf.
+    uint32_t seat() {
+        uint32_t leaf = free_leaves.back();
+        free_leaves.pop_back();
+        RAND_bytes(keys[leaf].data(), LKH_KEY_LEN);
+        for (uint32_t n = leaf;; n = parent(n)) {
+            count[n]++;
+            if (n == 0) break;
+        }
+        return leaf;
+    }
+
+    // Admits a member and rekeys its path. Returns the leaf, or UINT32_MAX if full.
+    uint32_t join(std::vector<uint8_t>& broadcast, std::vector<uint8_t>& unicast) {
+        if (free_leaves.empty()) return UINT32_MAX;
+        uint32_t leaf = free_leaves.back();
+        free_leaves.pop_back();
+        RAND_bytes(keys[leaf].data(), LKH_KEY_LEN);
+        count[leaf] = 1;
+        for (uint32_t n = leaf; n != 0;) {
+            n = parent(n);
+            LkhKey fresh;
+            RAND_bytes(fresh.data(), LKH_KEY_LEN);
+            if (count[n] > 0) {
+                // Existing members unwrap the new key with the old one.
+                lkh_put_u32(broadcast, n);
+                lkh_put_u32(broadcast, n);
+                broadcast.resize(broadcast.size() + LKH_WRAP_LEN);
+                wrapper.wrap(keys[n], fresh, broadcast.data() + broadcast.size() - LKH_WRAP_LEN);
+            }
+            keys[n] = fresh;
+            count[n]++;
+            entry(unicast, n, leaf);
+        }
+        return leaf;
+    }
+
+    // Removes the member at leaf and rekeys its path under the remaining children.
+    void revoke(uint32_t leaf, std::vector<uint8_t>& broadcast) {
+        for (uint32_t n = leaf;; n = parent(n)) {
+            count[n]--;
+            if (n == 0) break;
+        }
+        free_leaves.push_back(leaf);
+        for (uint32_t n = leaf; n != 0;) {
+            n = parent(n);
+            if (count[n] == 0) continue;
+            RAND_bytes(keys[n].data(), LKH_KEY_LEN);
+            for (uint32_t c = degree * n + 1; c <= degree * n + degree; ++c)
+                if (count[c] > 0) entry(broadcast, n, c);
+        }
+    }
+};
+
+// Member side: the keys on one leaf-to-root path.
+struct LkhMember {
+    std::vector<uint32_t> nodes; // leaf first, root last
+    std::vector<LkhKey> keys;
+
+    void init(const LkhTree& tree, uint32_t leaf, const LkhKey& leaf_key) {
+        nodes.clear();
+        keys.clear();
+        for (uint32_t n = leaf;; n = tree.parent(n)) {
+            nodes.push_back(n);
+            keys.push_back(n == leaf ? leaf_key : LkhKey{});
+            if (n == 0) break;
+        }
+    }
+
+    // Snapshot of the member's current path keys, as if it had followed every rekey.
+    void init_from(const LkhTree& tree, uint32_t leaf) {
+        init(tree, leaf, tree.keys[leaf]);
+        for (size_t i = 1; i < nodes.size(); ++i) keys[i] = tree.keys[nodes[i]];
+    }
+
+    int index_of(uint32_t node) const {
+        for (size_t i = 0; i < nodes.size(); ++i)
+            if (nodes[i] == node) return i;
+        return -1;
+    }
+
+    // Applies a rekey message. Returns the number of keys updated, or -1 if an entry
+    // addressed to this member does not unwrap.
+    int apply(LkhWrapper& wrapper, const uint8_t* msg, size_t len) {
+        int updated = 0;
+        for (size_t off = 0; off + LKH_ENTRY_LEN <= len; off += LKH_ENTRY_LEN) {
+            int kek = index_of(lkh_get_u32(msg + off + 4));
+            if (kek < 0) continue;
+            int target = index_of(lkh_get_u32(msg + off));
+            if (target < 0) continue;
+            if (!wrapper.unwrap(keys[kek], msg + off + 8, keys[target])) return -1;
+            updated++;
+        }
+        return updated;
+    }
+
+    const LkhKey& group_key() const { return keys.back(); }
+};
@@ -0,0 +1,227 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include"trace.cpp"
+
+// Asynchronous logger shared by the TA and the vehicle.
+//
+// LOG_DEBUG/LOG_INFO/LOG_WARN/LOG_ERROR below SGKD_LOG_LEVEL expand to nothing, so
+// their arguments are not even evaluated. Enabled calls copy the format pointer and
+// binary-encoded arguments into a per-thread single-producer ring; a background
+// thread formats the records ("{}" placeholders) and writes them to stdout.
+// A full ring drops the record instead of blocking the caller.
+//
+// Build with -DSGKD_LOG_LEVEL=SGKD_LOG_OFF (make LOG_LEVEL=4) to disable logging.
+
+#define SGKD_LOG_DEBUG 0
+#define SGKD_LOG_INFO 1
+#define SGKD_LOG_WARN 2
+#define SGKD_LOG_ERROR 3
+#define SGKD_LOG_OFF 4
+
+#ifndef SGKD_LOG_LEVEL
+#define SGKD_LOG_LEVEL SGKD_LOG_INFO
+#endif
+
+#define LOG_RING_SIZE 1024   // records per thread, must be a power of two
+#define LOG_PAYLOAD_SIZE 224 // encoded argument bytes per record
+
+enum LogArgType : uint8_t { LOG_ARG_I64, LOG_ARG_U64, LOG_ARG_F64, LOG_ARG_STR };
+
+struct LogRecord {
+    const char* fmt; // string literal
+    uint64_t tsc;
+    uint8_t level;
+    uint8_t nargs;
+    uint16_t used;
+    uint8_t payload[LOG_PAYLOAD_SIZE];
+};
+
+struct LogRing {
+    LogRecord records[LOG_RING_SIZE];
+    std::atomic<uint64_t> head{0}; // written by the owning thread
+    std::atomic<uint64_t> tail{0}; // written by the drain thread
+};
+
+Counter metric_log_dropped("sgkd_log_dropped_total", "Log records dropped because a thread's log ring was full.");
+
+struct Logger {
+    std::mutex rings_mutex;
+    std::vector<LogRing*> rings;
+    std::atomic<bool> stop{false};
+    std::thread drain;
+};
+
+inline Logger& logger() {
+    static Logger l;
+    return l;
+}
+
+inline void log_put_raw(LogRecord& r, LogArgType type, const void* data, size_t len) {
+    if (r.used + 1 + len > LOG_PAYLOAD_SIZE) return; // silently truncate the argument list
+    r.payload[r.used++] = type;
+    memcpy(r.payload + r.used, data, len);
+    r.used += len;
+    r.nargs++;
+}
+
+inline void log_put_str(LogRecord& r, const char* s, size_t len) {
+    size_t room = LOG_PAYLOAD_SIZE - r.used;
+    if (room < 3) return;
+    len = std::min(len, std::min<size_t>(room - 2, 255));
+    r.payload[r.used++] = LOG_ARG_STR;
+    r.payload[r.used++] = uint8_t(len);
+    memcpy(r.payload + r.used, s, len);
+    r.used += len;
+    r.nargs++;
+}
+
+template <typename T>
+inline void log_put(LogRecord& r, const T& v) {
+    using D = std::decay_t<T>;
+    if constexpr (std::is_same_v<D, const char*> || std::is_same_v<D, char*>) {
+        const char* s = v;
+        log_put_str(r, s, strlen(s));
+    } else if constexpr (std::is_same_v<D, std::string>) {
+        log_put_str(r, v.data(), v.size());
+    } else if constexpr (std::is_floating_point_v<D>) {
+        double d = v;
+        log_put_raw(r, LOG_ARG_F64, &d, sizeof(d));
+    } else if constexpr (std::is_integral_v<D> && std::is_signed_v<D>) {
+        int64_t i = v;
+        log_put_raw(r, LOG_ARG_I64, &i, sizeof(i));
+    } else if constexpr (std::is_integral_v<D>) {
+        uint64_t u = v;
+        log_put_raw(r, LOG_ARG_U64, &u, sizeof(u));
+    } else {
+        static_assert(sizeof(D) == 0, "unsupported log argument type");
+    }
+}
+
+void log_format(const LogRecord& r, std::string& out) {
+    static const char* names[] = {"[DEBUG] ", "[INFO] ", "[WARN] ", "[ERROR] "};
+    out += names[r.level];
+    size_t pos = 0;
+    int remaining = r.nargs;
+    char num[64];
+    for (const char* p = r.fmt; *p; ++p) {
+        if (p[0] != '{' || p[1] != '}' || remaining == 0) {
+            out += *p;
+            continue;
+        }
+        ++p;
+        --remaining;
+        uint8_t type = r.payload[pos++];
+        switch (type) {
+        case LOG_ARG_I64: { int64_t v; memcpy(&v, r.payload + pos, 8); pos += 8; snprintf(num, sizeof(num), "%lld", (long long)v); out += num; break; }
+        case LOG_ARG_U64: { uint64_t v; memcpy(&v, r.payload + pos, 8); pos += 8; snprintf(num, sizeof(num), "%llu", (unsigned long long)v); out += num; break; }
+        case LOG_ARG_F64: { double v; memcpy(&v, r.payload + pos, 8); pos += 8; snprintf(num, sizeof(num), "%g", v); out += num; break; }
+        case LOG_ARG_STR: { uint8_t n = r.payload[pos++]; out.append((const char*)r.payload + pos, n); pos += n; break; }
+        }
+    }
+    out += '\n';
+}
+
+// Drains every ring once. Records are ordered by timestamp within a pass.
+bool log_drain_once(std::string& out) {
+    Logger& l = logger();
+    std::vector<LogRing*> rings;
+    {
+        std::lock_guard<std::mutex> lock(l.rings_mutex);
+        rings = l.rings;
+    }
+    std::vector<const LogRecord*> batch;
+    std::vector<std::pair<LogRing*, uint64_t>> consumed;
+    for (LogRing* ring : rings) {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        for (uint64_t i = tail; i < head; ++i) batch.push_back(&ring->records[i & (LOG_RING_SIZE - 1)]);
+        if (head != tail) consumed.emplace_back(ring, head);
+    }
+    if (batch.empty()) return false;
+    std::sort(batch.begin(), batch.end(),
+              [](const LogRecord* a, const LogRecord* b) { return a->tsc < b->tsc; });
+    out.clear();
+    for (const LogRecord* r : batch) log_format(*r, out);
+    for (auto& [ring, head] : consumed) ring->tail.store(head, std::memory_order_release);
+    fwrite(out.data(), 1, out.size(), stdout);
+    fflush(stdout);
+    return true;
+}
+
+void log_shutdown() {
+    Logger& l = logger();
+    l.stop.store(true);
+    if (l.drain.joinable()) l.drain.join();
+    std::string out;
+    while (log_drain_once(out)) {}
+}
+
+inline LogRing* log_local_ring() {
+    thread_local LogRing* ring = [] {
+        Logger& l = logger();
+        LogRing* r = new LogRing();
+        std::lock_guard<std::mutex> lock(l.rings_mutex);
+        l.rings.push_back(r);
+        if (!l.drain.joinable()) {
+            l.drain = std::thread([] {
+                std::string out;
+                while (!logger().stop.load()) {
+                    if (!log_drain_once(out))
+                        std::this_thread::sleep_for(std::chrono::microseconds(500));
+                }
+            });
+            atexit(log_shutdown);
+        }
+        return r;
+    }();
+    return ring;
+}
+
+template <typename... Args>
+void log_write(int level, const char* fmt, const Args&... args) {
+    LogRing* ring = log_local_ring();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= LOG_RING_SIZE) {
+        metric_log_dropped.inc();
+        return;
+    }
+    LogRecord& r = ring->records[head & (LOG_RING_SIZE - 1)];
+    r.fmt = fmt;
+    r.tsc = trace_clock();
+    r.level = uint8_t(level);
+    r.nargs = 0;
+    r.used = 0;
+    (log_put(r, args), ...);
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+#if SGKD_LOG_LEVEL <= SGKD_LOG_DEBUG
+#define LOG_DEBUG(...) log_write(SGKD_LOG_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+#if SGKD_LOG_LEVEL <= SGKD_LOG_INFO
+#define LOG_INFO(...) log_write(SGKD_LOG_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+#if SGKD_LOG_LEVEL <= SGKD_LOG_WARN
+#define LOG_WARN(...) log_write(SGKD_LOG_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+#if SGKD_LOG_LEVEL <= SGKD_LOG_ERROR
+#define LOG_ERROR(...) log_write(SGKD_LOG_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// TA-side member table: vehicle ID -> serialized member secret.
+// Lets the TA revoke a specific vehicle instead of only the last one registered.
+// Revoked IDs are remembered so authenticated vehicles cannot register again.
+struct MemberTable {
+    std::unordered_map<std::string, std::vector<uint8_t>> secrets;
+    std::unordered_set<std::string> revoked;
+
+    // A vehicle registering again under the same ID replaces its old secret.
+    void add(const std::string& id, std::vector<uint8_t> secret) {
+        secrets[id] = std::move(secret);
+    }
+
+    // Removes the member and hands back its secret. Returns false for unknown IDs.
+    bool take(const std::string& id, std::vector<uint8_t>& secret) {
+        auto it = secrets.find(id);
+        if (it == secrets.end()) return false;
+        secret = std::move(it->second);
+        secrets.erase(it);
+        revoked.insert(id);
+        return true;
+    }
+
+    const std::vector<uint8_t>* find(const std::string& id) const {
+        auto it = secrets.find(id);
+        return it == secrets.end() ? nullptr : &it->second;
+    }
+
+    bool is_revoked(const std::string& id) const { return revoked.count(id) != 0; }
+
+    size_t size() const { return secrets.size(); }
+};
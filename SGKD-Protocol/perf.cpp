@@ -0,0 +1,132 @@
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Hardware performance counters for the benchmark harnesses.
+//
+// With SGKD_PERF=1 in the environment, every benchmark_stats() run also counts cycles,
+// instructions, L1D read misses, LLC read misses and branch misses with perf_event_open
+// (user space only) and perf_report() prints them per operation under the timing line.
+// SGKD_PERF_CSV=FILE additionally appends one row per measurement to FILE.
+//
+// Counters that cannot be opened (no PMU in a VM, perf_event_paranoid, missing event)
+// are reported as n/a; when none can be opened the benchmarks run exactly as before.
+// Counts are scaled by time_enabled / time_running when the kernel multiplexes them.
+
+enum PerfEvent { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_L1D_MISSES, PERF_LLC_MISSES, PERF_BRANCH_MISSES, PERF_EVENTS };
+
+static const char* perf_event_names[PERF_EVENTS] = {"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+
+struct PerfState {
+    bool initialized = false;
+    bool enabled = false;
+    int fd[PERF_EVENTS] = {-1, -1, -1, -1, -1};
+    double per_op[PERF_EVENTS] = {0};
+    bool valid[PERF_EVENTS] = {false};
+    FILE* csv = nullptr;
+};
+
+static PerfState perf_state;
+
+static int perf_open(uint32_t type, uint64_t config) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t perf_cache_miss(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+// Opens the counters on first use. Returns true if at least one counter is available.
+bool perf_enabled() {
+    if (perf_state.initialized) return perf_state.enabled;
+    perf_state.initialized = true;
+    const char* env = getenv("SGKD_PERF");
+    if (!env || strcmp(env, "0") == 0) return false;
+
+    perf_state.fd[PERF_CYCLES] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    int open_errno = errno;
+    perf_state.fd[PERF_INSTRUCTIONS] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    perf_state.fd[PERF_L1D_MISSES] = perf_open(PERF_TYPE_HW_CACHE, perf_cache_miss(PERF_COUNT_HW_CACHE_L1D));
+    perf_state.fd[PERF_LLC_MISSES] = perf_open(PERF_TYPE_HW_CACHE, perf_cache_miss(PERF_COUNT_HW_CACHE_LL));
+    perf_state.fd[PERF_BRANCH_MISSES] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    for (int i = 0; i < PERF_EVENTS; ++i) perf_state.enabled |= perf_state.fd[i] >= 0;
+    if (!perf_state.enabled) {
+        fprintf(stderr, "[WARN] Hardware counters unavailable (%s); reporting timings only\n", strerror(open_errno));
+        return false;
+    }
+
+    const char* path = getenv("SGKD_PERF_CSV");
+    if (path) {
+        perf_state.csv = fopen(path, "a");
+        if (!perf_state.csv) {
+            fprintf(stderr, "[WARN] Cannot open %s for counter export\n", path);
+        } else if (ftell(perf_state.csv) == 0) {
+            fprintf(perf_state.csv, "label,mean_ns,std_ns");
+            for (int i = 0; i < PERF_EVENTS; ++i) fprintf(perf_state.csv, ",%s", perf_event_names[i]);
+            fprintf(perf_state.csv, "\n");
+        }
+    }
+    return true;
+}
+
+void perf_begin() {
+    if (!perf_enabled()) return;
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        if (perf_state.fd[i] < 0) continue;
+        ioctl(perf_state.fd[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(perf_state.fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+// Stops the counters and stores their per-operation averages over ops operations.
+void perf_end(uint64_t ops) {
+    if (!perf_state.enabled) return;
+    for (int i = 0; i < PERF_EVENTS; ++i)
+        if (perf_state.fd[i] >= 0) ioctl(perf_state.fd[i], PERF_EVENT_IOC_DISABLE, 0);
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        uint64_t data[3]; // value, time_enabled, time_running
+        perf_state.valid[i] = perf_state.fd[i] >= 0 &&
+                              read(perf_state.fd[i], data, sizeof(data)) == (ssize_t)sizeof(data) && data[2] > 0;
+        if (perf_state.valid[i])
+            perf_state.per_op[i] = double(data[0]) * data[1] / data[2] / (ops ? ops : 1);
+    }
+}
+
+// Prints the counters of the last benchmark_stats() run, per operation, and appends
+// them to the CSV export. Does nothing unless counters are enabled.
+void perf_report(const char* label, double mean_ns, double std_ns) {
+    if (!perf_state.enabled) return;
+    printf("    ");
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        if (perf_state.valid[i]) printf("%s %.0f  ", perf_event_names[i], perf_state.per_op[i]);
+        else printf("%s n/a  ", perf_event_names[i]);
+    }
+    if (perf_state.valid[PERF_CYCLES] && perf_state.valid[PERF_INSTRUCTIONS] && perf_state.per_op[PERF_CYCLES] > 0)
+        printf("IPC %.2f", perf_state.per_op[PERF_INSTRUCTIONS] / perf_state.per_op[PERF_CYCLES]);
+    printf("\n");
+    fflush(stdout);
+    if (perf_state.csv) {
+        fprintf(perf_state.csv, "%s,%.1f,%.1f", label, mean_ns, std_ns);
+        for (int i = 0; i < PERF_EVENTS; ++i) {
+            if (perf_state.valid[i]) fprintf(perf_state.csv, ",%.1f", perf_state.per_op[i]);
+            else fprintf(perf_state.csv, ",");
+        }
+        fprintf(perf_state.csv, "\n");
+        fflush(perf_state.csv);
+    }
+}
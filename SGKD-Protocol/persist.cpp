@@ -0,0 +1,139 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/sha.h>
+
+// Persistent vehicle state for instant cold start.
+//
+// The state file is a header followed by one record per group, little endian:
+//   header  magic "SGKDVST\0" (8) | version (4) | records (4) | SHA-256 of the body (32)
+//   body    records as written by the caller with StateWriter
+// Saving writes the whole file through a shared mapping of FILE.tmp and renames it
+// over FILE, so a crash leaves either the old or the new state. Loading maps the file
+// read-only, checks magic, version and checksum, and decodes the records in place.
+// A file that fails any check is reported and ignored; the caller then starts from
+// scratch. vehicle.cpp defines the record contents.
+
+#define STATE_MAGIC "SGKDVST"
+#define STATE_VERSION 2
+#define STATE_HEADER_LEN (8 + 4 + 4 + SHA256_DIGEST_LENGTH)
+#define STATE_MAX_SIZE (16 * 1024 * 1024)
+
+// Append-only encoder for the state body.
+struct StateWriter {
+    std::vector<uint8_t> buf;
+    uint32_t records = 0;
+    void u32(uint32_t v) { for (int i = 0; i < 4; ++i) buf.push_back(uint8_t(v >> (8 * i))); }
+    void u64(uint64_t v) { for (int i = 0; i < 8; ++i) buf.push_back(uint8_t(v >> (8 * i))); }
+    void bytes(const uint8_t* p, uint32_t n) {
+        u32(n);
+        buf.insert(buf.end(), p, p + n);
+    }
+};
+
+// Bounds-checked decoder over the mapping; any overrun sets ok = false. Byte strings
+// are returned as pointers into the mapping, valid while the StateFile is open.
+struct StateReader {
+    const uint8_t* p;
+    size_t left;
+    bool ok = true;
+    uint32_t u32() {
+        if (left < 4) { ok = false; return 0; }
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v |= uint32_t(p[i]) << (8 * i);
+        p += 4; left -= 4;
+        return v;
+    }
+    uint64_t u64() {
+        if (left < 8) { ok = false; return 0; }
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) v |= uint64_t(p[i]) << (8 * i);
+        p += 8; left -= 8;
+        return v;
+    }
+    const uint8_t* bytes(uint32_t& n) {
+        n = u32();
+        if (!ok || left < n) { ok = false; n = 0; return nullptr; }
+        const uint8_t* v = p;
+        p += n; left -= n;
+        return v;
+    }
+};
+
+bool state_save(const std::string& path, const StateWriter& w) {
+    std::string tmp = path + ".tmp";
+    size_t size = STATE_HEADER_LEN + w.buf.size();
+    int fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) return false;
+    if (ftruncate(fd, size) < 0) {
+        ::close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+    uint8_t* out = (uint8_t*)map;
+    memcpy(out, STATE_MAGIC, 8);
+    for (int i = 0; i < 4; ++i) out[8 + i] = uint8_t(STATE_VERSION >> (8 * i));
+    for (int i = 0; i < 4; ++i) out[12 + i] = uint8_t(w.records >> (8 * i));
+    SHA256(w.buf.data(), w.buf.size(), out + 16);
+    memcpy(out + STATE_HEADER_LEN, w.buf.data(), w.buf.size());
+    bool ok = msync(map, size, MS_SYNC) == 0;
+    munmap(map, size);
+    return ok && rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// A validated read-only mapping of a state file.
+struct StateFile {
+    void* map = MAP_FAILED;
+    size_t size = 0;
+    uint32_t records = 0;
+
+    StateFile() = default;
+    StateFile(const StateFile&) = delete;
+    StateFile& operator=(const StateFile&) = delete;
+    ~StateFile() {
+        if (map != MAP_FAILED) munmap(map, size);
+    }
+
+    // Returns false if the file is missing or fails a check; every failure except a
+    // missing file is logged.
+    bool open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st{};
+        if (fstat(fd, &st) < 0 || st.st_size < STATE_HEADER_LEN || st.st_size > STATE_MAX_SIZE) {
+            ::close(fd);
+            LOG_WARN("Ignoring state file {}: bad size", path);
+            return false;
+        }
+        size = st.st_size;
+        map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) return false;
+        const uint8_t* in = (const uint8_t*)map;
+        uint32_t version = 0;
+        for (int i = 0; i < 4; ++i) version |= uint32_t(in[8 + i]) << (8 * i);
+        for (int i = 0; i < 4; ++i) records |= uint32_t(in[12 + i]) << (8 * i);
+        uint8_t digest[SHA256_DIGEST_LENGTH];
+        SHA256(in + STATE_HEADER_LEN, size - STATE_HEADER_LEN, digest);
+        if (memcmp(in, STATE_MAGIC, 8) != 0) {
+            LOG_WARN("Ignoring state file {}: not a vehicle state file", path);
+        } else if (version != STATE_VERSION) {
+            LOG_WARN("Ignoring state file {}: version {} (expected {})", path, version, STATE_VERSION);
+        } else if (memcmp(digest, in + 16, SHA256_DIGEST_LENGTH) != 0) {
+            LOG_WARN("Ignoring state file {}: checksum mismatch", path);
+        } else {
+            return true;
+        }
+        return false;
+    }
+
+    StateReader body() const { return {(const uint8_t*)map + STATE_HEADER_LEN, size - STATE_HEADER_LEN}; }
+};
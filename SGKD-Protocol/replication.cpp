@@ -0,0 +1,339 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <unistd.h>
+#include"auth.cpp"
+
+// Hot-standby replication transport for the TA.
+//
+// The primary streams an ordered log of state changes to one standby over TCP. The
+// link is keyed by a provisioned secret (--repl-key): on connect both sides send a
+// random nonce and derive a fresh link key with HKDF over the secret and both nonces.
+// Every record is AES-256-GCM(link key, type (1) | seq (8) | payload), sent as
+// len (4) | sealed, little endian. The standby accepts a connection only if its first
+// record opens under the link key.
+//
+// The first record is a full snapshot; after that each registration, revocation and
+// epoch change is sent before its result leaves the primary, and a heartbeat is sent
+// every REPL_HEARTBEAT_MS. The standby applies records in order, acknowledges each
+// state change, and promotes itself once the primary has been silent for
+// REPL_FAILOVER_MS or the connection drops.
+//
+// Fencing: the primary lets a change out only after the standby acknowledged it. If
+// the acknowledgement does not come within REPL_ACK_TIMEOUT_MS, or the link drops, the
+// standby may be about to promote, so the primary fences itself and issues nothing
+// more. Everything vehicles have seen is therefore in the standby's state, and a
+// partitioned primary and a promoted standby never both issue updates.
+//
+// This file only knows about framing, keys and liveness; ta.cpp encodes and applies
+// the TA-specific payloads.
+
+#define REPL_PORT 9878
+#define REPL_HEARTBEAT_MS 100
+#define REPL_FAILOVER_MS 500
+#define REPL_ACK_TIMEOUT_MS 250
+#define REPL_AUTH_TIMEOUT_MS 5000 // for a connecting primary's first record, and the snapshot ack
+#define REPL_CONNECT_RETRIES 50
+#define REPL_MAX_RECORD (64 * 1024 * 1024)
+#define REPL_RECORD_HEADER 9 // type (1) | seq (8), inside the sealed record
+
+enum ReplRecordType : uint8_t {
+    REPL_SNAPSHOT = 1,
+    REPL_REGISTER = 2,
+    REPL_REVOKE = 3,
+    REPL_HEARTBEAT = 4,
+};
+
+Counter metric_repl_records("sgkd_replication_records_total", "State-change records streamed to the standby.");
+Counter metric_repl_bytes("sgkd_replication_bytes_total", "Bytes streamed to the standby.");
+Histogram metric_repl_send("sgkd_replication_send_seconds", "Time spent writing one record to the standby.");
+
+// Append-only payload encoder.
+struct ReplWriter {
+    std::vector<uint8_t> buf;
+    void u8(uint8_t v) { buf.push_back(v); }
+    void u64(uint64_t v) { for (int i = 0; i < 8; ++i) buf.push_back(uint8_t(v >> (8 * i))); }
+    void bytes(const uint8_t* p, uint32_t n) {
+        for (int i = 0; i < 4; ++i) buf.push_back(uint8_t(n >> (8 * i)));
+        buf.insert(buf.end(), p, p + n);
+    }
+    void bytes(const std::vector<uint8_t>& v) { bytes(v.data(), v.size()); }
+    void str(const std::string& s) { bytes((const uint8_t*)s.data(), s.size()); }
+};
+
+// Bounds-checked payload decoder; any overrun sets ok = false.
+struct ReplReader {
+    const uint8_t* p;
+    size_t left;
+    bool ok = true;
+    ReplReader(const std::vector<uint8_t>& v) : p(v.data()), left(v.size()) {}
+    uint8_t u8() {
+        if (left < 1) { ok = false; return 0; }
+        left--;
+        return *p++;
+    }
+    uint64_t u64() {
+        if (left < 8) { ok = false; return 0; }
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) v |= uint64_t(p[i]) << (8 * i);
+        p += 8; left -= 8;
+        return v;
+    }
+    std::vector<uint8_t> bytes() {
+        if (left < 4) { ok = false; return {}; }
+        uint32_t n = 0;
+        for (int i = 0; i < 4; ++i) n |= uint32_t(p[i]) << (8 * i);
+        p += 4; left -= 4;
+        if (left < n) { ok = false; return {}; }
+        std::vector<uint8_t> v(p, p + n);
+        p += n; left -= n;
+        return v;
+    }
+    std::string str() {
+        std::vector<uint8_t> v = bytes();
+        return std::string(v.begin(), v.end());
+    }
+};
+
+struct ReplicationLink {
+    int sock = -1;
+    uint64_t seq = 0;
+    Bytes key; // link key of this connection
+    std::mutex write_mutex;
+    std::atomic<bool> up{false};
+    std::atomic<bool> fenced{false};
+    std::mutex ack_mutex;
+    std::condition_variable ack_ready;
+    uint64_t acked = 0; // highest seq the standby has applied, under ack_mutex
+};
+
+ReplicationLink repl_link;
+Bytes repl_key; // --repl-key; provisioned secret shared by the primary and the standby
+
+// Loads the replication secret: AUTH_KEY_LEN raw bytes, e.g. from `openssl rand`.
+bool repl_load_key(const std::string& path) {
+    return auth_read_file(path, repl_key) && repl_key.size() == AUTH_KEY_LEN;
+}
+
+bool repl_write_all(int sock, const uint8_t* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = send(sock, p, n, MSG_NOSIGNAL);
+        if (w <= 0) return false;
+        p += w;
+        n -= w;
+    }
+    return true;
+}
+
+bool repl_read_all(int sock, uint8_t* p, size_t n) {
+    return n == 0 || recv(sock, p, n, MSG_WAITALL) == (ssize_t)n;
+}
+
+bool repl_send_frame(int sock, const Bytes& sealed) {
+    uint8_t len[4];
+    for (int i = 0; i < 4; ++i) len[i] = uint8_t(sealed.size() >> (8 * i));
+    return repl_write_all(sock, len, sizeof(len)) && repl_write_all(sock, sealed.data(), sealed.size());
+}
+
+// Receives one frame and opens it under key. False on a broken link or a frame that
+// was not sealed under key.
+bool repl_recv_frame(int sock, const Bytes& key, const char* aad, Bytes& plaintext) {
+    uint8_t len[4];
+    if (!repl_read_all(sock, len, sizeof(len))) return false;
+    uint32_t n = 0;
+    for (int i = 0; i < 4; ++i) n |= uint32_t(len[i]) << (8 * i);
+    if (n > REPL_MAX_RECORD + REPL_RECORD_HEADER + AUTH_GCM_IV_LEN + AUTH_GCM_TAG_LEN) return false;
+    Bytes sealed(n);
+    return repl_read_all(sock, sealed.data(), n) && auth_open(key.data(), aad, sealed, plaintext);
+}
+
+// Exchanges nonces and derives the link key HKDF(repl_key, nonce_primary | nonce_standby).
+bool repl_link_key(int sock, bool primary, Bytes& key) {
+    Bytes mine = auth_random(AUTH_NONCE_LEN), theirs(AUTH_NONCE_LEN);
+    if (!repl_write_all(sock, mine.data(), mine.size()) || !repl_read_all(sock, theirs.data(), theirs.size()))
+        return false;
+    Bytes salt = primary ? mine : theirs;
+    auth_append(salt, primary ? theirs : mine);
+    key = auth_hkdf(repl_key, salt, "SGKD replication", AUTH_KEY_LEN);
+    return key.size() == AUTH_KEY_LEN;
+}
+
+// Stops this primary from issuing anything for good, because the standby may promote.
+void (*repl_on_fence)() = nullptr; // e.g. releases the ports the standby takes over
+void repl_fence(const char* reason) {
+    if (repl_link.fenced.exchange(true)) return;
+    LOG_ERROR("Fenced: {}. This TA issues nothing more; the standby takes over", reason);
+    repl_link.up.store(false);
+    {
+        std::lock_guard<std::mutex> lock(repl_link.ack_mutex);
+        repl_link.ack_ready.notify_all();
+    }
+    if (repl_on_fence) repl_on_fence();
+}
+bool repl_fenced() { return repl_link.fenced.load(); }
+
+// Streams one record to the standby and, unless it is a heartbeat, waits until the
+// standby has applied it. Returns false if this TA is fenced, in which case the change
+// must not leave it. Without a standby there is nothing to wait for.
+bool repl_send(ReplRecordType type, const std::vector<uint8_t>& payload) {
+    if (repl_link.fenced.load()) return false;
+    if (!repl_link.up.load()) return true;
+    HistogramTimer timer(metric_repl_send);
+    uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(repl_link.write_mutex);
+        if (!repl_link.up.load()) return !repl_link.fenced.load();
+        seq = ++repl_link.seq;
+        Bytes record;
+        record.push_back(type);
+        auth_append_u64(record, seq);
+        auth_append(record, payload);
+        Bytes sealed = auth_seal(repl_link.key.data(), "SGKD-repl", record);
+        if (sealed.empty() || !repl_send_frame(repl_link.sock, sealed)) {
+            shutdown(repl_link.sock, SHUT_RDWR);
+            repl_fence("replication link to the standby lost");
+            return false;
+        }
+        metric_repl_records.inc();
+        metric_repl_bytes.inc(4 + sealed.size());
+    }
+    if (type == REPL_HEARTBEAT) return true;
+    int timeout_ms = type == REPL_SNAPSHOT ? REPL_AUTH_TIMEOUT_MS : REPL_ACK_TIMEOUT_MS;
+    std::unique_lock<std::mutex> lock(repl_link.ack_mutex);
+    repl_link.ack_ready.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                                 [seq] { return repl_link.acked >= seq || repl_link.fenced.load(); });
+    if (repl_link.acked >= seq) return true;
+    lock.unlock();
+    repl_fence("the standby did not acknowledge a state change in time");
+    return false;
+}
+
+// Connects the primary to a standby on host:port and starts the heartbeat thread.
+bool repl_connect(const std::string& host, int port = REPL_PORT) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
+    for (int attempt = 0; attempt < REPL_CONNECT_RETRIES; ++attempt) {
+        int sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock < 0) return false;
+        if (connect(sock, (sockaddr*)&addr, sizeof(addr)) == 0) {
+            int nodelay = 1;
+            setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+            if (!repl_link_key(sock, true, repl_link.key)) {
+                close(sock);
+                return false;
+            }
+            repl_link.sock = sock;
+            repl_link.up.store(true);
+            std::thread([] {
+                while (repl_link.up.load()) {
+                    repl_send(REPL_HEARTBEAT, {});
+                    std::this_thread::sleep_for(std::chrono::milliseconds(REPL_HEARTBEAT_MS));
+                }
+            }).detach();
+            // Acknowledgements from the standby. This thread owns the socket and closes it.
+            std::thread([sock] {
+                Bytes ack;
+                while (repl_recv_frame(sock, repl_link.key, "SGKD-repl-ack", ack) && ack.size() == 8) {
+                    std::lock_guard<std::mutex> lock(repl_link.ack_mutex);
+                    repl_link.acked = std::max(repl_link.acked, auth_read_u64(ack.data()));
+                    repl_link.ack_ready.notify_all();
+                }
+                repl_fence("replication link to the standby lost");
+                std::lock_guard<std::mutex> lock(repl_link.write_mutex);
+                close(sock);
+            }).detach();
+            return true;
+        }
+        close(sock);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return false;
+}
+
+// Standby side: accepts the primary and hands each record to apply() in order. Returns
+// when the primary fails, i.e. when it is time to promote. silent_ms receives how long
+// the primary had been silent when the failure was detected. The standby listens on
+// loopback only, or on all interfaces for connections from peer if one is given.
+template <typename Apply>
+void repl_follow(Apply apply, double& silent_ms, int port = REPL_PORT, const std::string& peer = "") {
+    in_addr peer_addr{};
+    if (!peer.empty() && inet_pton(AF_INET, peer.c_str(), &peer_addr) != 1) handle_error("bad primary address " + peer);
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = peer.empty() ? htonl(INADDR_LOOPBACK) : INADDR_ANY;
+    if (listener < 0 || bind(listener, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listener, 1) < 0)
+        handle_error("replication listener failed");
+    std::cout << "[INFO] Standby waiting for the primary " << (peer.empty() ? "127.0.0.1" : peer) << " on port "
+              << port << std::endl;
+
+    // Until a connection proves the key with its first record, it is not the primary.
+    int sock = -1;
+    Bytes key, record;
+    while (sock < 0) {
+        sockaddr_in from{};
+        socklen_t from_len = sizeof(from);
+        int s = accept(listener, (sockaddr*)&from, &from_len);
+        if (s < 0) {
+            if (errno == EINTR) continue;
+            handle_error("replication accept failed");
+        }
+        timeval timeout{REPL_AUTH_TIMEOUT_MS / 1000, 0};
+        setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        bool ok = (peer.empty() || from.sin_addr.s_addr == peer_addr.s_addr) && repl_link_key(s, false, key) &&
+                  repl_recv_frame(s, key, "SGKD-repl", record);
+        if (!ok) {
+            LOG_WARN("Refused a replication connection from {}", inet_ntoa(from.sin_addr));
+            close(s);
+            continue;
+        }
+        timeout = {0, 0};
+        setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        sock = s;
+    }
+    close(listener);
+
+    auto last_seen = std::chrono::steady_clock::now();
+    uint64_t expected_seq = 1;
+    while (true) {
+        uint64_t seq = record.size() >= REPL_RECORD_HEADER ? auth_read_u64(record.data() + 1) : 0;
+        if (seq != expected_seq) {
+            LOG_ERROR("Replication stream corrupt at seq {} (expected {})", seq, expected_seq);
+            break;
+        }
+        expected_seq++;
+        last_seen = std::chrono::steady_clock::now();
+        if (record[0] != REPL_HEARTBEAT) {
+            apply(ReplRecordType(record[0]), std::vector<uint8_t>(record.begin() + REPL_RECORD_HEADER, record.end()));
+            Bytes ack;
+            auth_append_u64(ack, seq);
+            if (!repl_send_frame(sock, auth_seal(key.data(), "SGKD-repl-ack", ack))) break;
+        }
+
+        int ready = 0;
+        while (ready == 0) {
+            pollfd pfd{sock, POLLIN, 0};
+            ready = poll(&pfd, 1, REPL_HEARTBEAT_MS);
+            silent_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - last_seen).count();
+            if (ready == 0 && silent_ms >= REPL_FAILOVER_MS) break;
+        }
+        if (ready <= 0 || !repl_recv_frame(sock, key, "SGKD-repl", record)) break;
+    }
+    silent_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - last_seen).count();
+    close(sock);
+}
@@ -0,0 +1,215 @@
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <relic/relic.h>
+#include <openssl/sha.h>
+#include"utils.cpp"
+#include"members.cpp"
+#include"ecu.cpp"
+#include"lkh.cpp"
+using namespace std;
+#define SCALING_JOINS 100
+#define SCALING_REVOKES 100
+#define SCALING_MEMBER_SAMPLES 64
+#define SCALING_MAX_FLEET 1000000
+#define SCALING_PORT 9996 // --broadcast target, away from the vehicles' key update port
+#define SCALING_SEED 42
+
+// Side-by-side scaling benchmark: SGKD against an LKH key tree (lkh.cpp).
+//
+// For each fleet size (10, 100, ... up to --max) both schemes start from a populated
+// member table and then measure, with the same harness:
+//   join     TA cost of admitting a member, and the bytes it sends (unicast/broadcast)
+//   revoke   TA cost of revoking a member, and the rekey broadcast size
+//   member   CPU a remaining member spends applying one revocation
+// SGKD runs the TA arithmetic of synthetic_group.cpp and the member update of ecu.cpp;
+// LKH runs the tree and member code of lkh.cpp. Populating the fleet is not timed.
+// With --broadcast every revocation is also sent through udp_broadcast, the transport
+// of broadcast_key_update, and the send is included in the revoke cost.
+//
+// compile it using: g++ scaling.cpp -o sgkd-scaling -I/usr/local/relic/include -L/usr/local/relic/lib -lrelic_s -lssl -lcrypto -std=c++17
+
+struct SchemeResult {
+    pair<double, double> join, revoke; // ns, mean and std
+    double join_bcast = 0, join_unicast = 0, revoke_bcast = 0; // mean bytes
+    vector<double> member_ns;
+    bool consistent = true;
+};
+
+bool send_rekeys = false;
+
+string member_id(const char* prefix, size_t i) {
+    char id[32];
+    snprintf(id, sizeof(id), "%s%zu", prefix, i);
+    return id;
+}
+
+// Picks the revoked members and the members whose update cost is sampled, disjointly,
+// from the initial fleet. Both schemes use the same choice.
+void pick_members(size_t fleet, int revokes, int samples, vector<size_t>& victims, vector<size_t>& sampled) {
+    vector<size_t> order(fleet);
+    for (size_t i = 0; i < fleet; ++i) order[i] = i;
+    mt19937_64 rng(SCALING_SEED);
+    for (size_t i = 0; i < (size_t)(revokes + samples); ++i) swap(order[i], order[i + rng() % (fleet - i)]);
+    victims.assign(order.begin(), order.begin() + revokes);
+    sampled.assign(order.begin() + revokes, order.begin() + revokes + samples);
+}
+
+SchemeResult run_sgkd(size_t fleet, const vector<size_t>& victims) {
+    SchemeResult r;
+    MemberTable members;
+    for (size_t i = 0; i < fleet; ++i) {
+        vector<uint8_t> secret(32);
+        RAND_bytes(secret.data(), secret.size());
+        members.add(member_id("veh_", i), move(secret));
+    }
+    SyntheticGroup grp;
+    synthetic_setup(grp);
+    synthetic_issue(grp, ecu.x_i, ecu.w1, ecu.w2);
+    ecu.epoch = grp.epoch;
+    ecu.len_g2 = g2_size_bin(ecu.w2, 1);
+
+    bn_t x_i;
+    g1_t w1;
+    g2_t w2;
+    bn_new(x_i); g1_new(w1); g2_new(w2);
+    size_t joined = 0, unicast = 0;
+    r.join = benchmark_stats([&] {
+        synthetic_issue(grp, x_i, w1, w2);
+        members.add(member_id("new_", joined++), serialize_element(x_i));
+        unicast += 3 * sizeof(int) + bn_size_bin(x_i) + g1_size_bin(w1, 1) + g2_size_bin(w2, 1);
+    }, 1, SCALING_JOINS);
+    r.join_unicast = double(unicast) / SCALING_JOINS;
+
+    vector<vector<uint8_t>> updates(victims.size(), vector<uint8_t>(ECU_DATAGRAM_MAX));
+    vector<int> update_len(victims.size());
+    size_t revoked = 0, bcast = 0;
+    r.revoke = benchmark_stats([&] {
+        vector<uint8_t> secret;
+        members.take(member_id("veh_", victims[revoked]), secret);
+        int len = synthetic_revoke(grp, updates[revoked].data(), ECU_DATAGRAM_MAX);
+        if (send_rekeys) udp_broadcast(updates[revoked].data(), len, SCALING_PORT);
+        update_len[revoked++] = len;
+        bcast += len;
+    }, 1, victims.size());
+    r.revoke_bcast = double(bcast) / victims.size();
+
+    for (size_t k = 0; k < victims.size(); ++k) {
+        auto start = chrono::steady_clock::now();
+        r.consistent &= ecu_handle_update(updates[k].data(), update_len[k]);
+        r.member_ns.push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+    }
+    // The member's w2 must match what the TA would issue under the final A.
+    bn_add(x_i, ecu.x_i, grp.sk);
+    bn_mod_inv(x_i, x_i, grp.ord);
+    g2_mul(w2, grp.A, x_i);
+    r.consistent &= g2_cmp(w2, ecu.w2) == RLC_EQ;
+
+    bn_free(x_i); g1_free(w1); g2_free(w2);
+    synthetic_free(grp);
+    return r;
+}
+
+SchemeResult run_lkh(size_t fleet, int degree, const vector<size_t>& victims, const vector<size_t>& sampled) {
+    SchemeResult r;
+    LkhTree tree;
+    tree.init(fleet + SCALING_JOINS, degree);
+    MemberTable members;
+    auto seat_secret = [&](uint32_t leaf) {
+        vector<uint8_t> secret;
+        lkh_put_u32(secret, leaf);
+        secret.insert(secret.end(), tree.keys[leaf].begin(), tree.keys[leaf].end());
+        return secret;
+    };
+    for (size_t i = 0; i < fleet; ++i) members.add(member_id("veh_", i), seat_secret(tree.seat()));
+
+    size_t joined = 0, unicast = 0, bcast = 0;
+    vector<uint8_t> broadcast, direct;
+    r.join = benchmark_stats([&] {
+        broadcast.clear();
+        direct.clear();
+        uint32_t leaf = tree.join(broadcast, direct);
+        members.add(member_id("new_", joined++), seat_secret(leaf));
+        unicast += direct.size();
+        bcast += broadcast.size();
+    }, 1, SCALING_JOINS);
+    r.join_unicast = double(unicast) / SCALING_JOINS;
+    r.join_bcast = double(bcast) / SCALING_JOINS;
+
+    vector<LkhMember> samples(sampled.size());
+    for (size_t i = 0; i < sampled.size(); ++i)
+        samples[i].init_from(tree, lkh_get_u32(members.find(member_id("veh_", sampled[i]))->data()));
+
+    vector<vector<uint8_t>> rekeys(victims.size());
+    size_t revoked = 0;
+    bcast = 0;
+    r.revoke = benchmark_stats([&] {
+        vector<uint8_t> secret;
+        members.take(member_id("veh_", victims[revoked]), secret);
+        tree.revoke(lkh_get_u32(secret.data()), rekeys[revoked]);
+        if (send_rekeys) udp_broadcast(rekeys[revoked].data(), rekeys[revoked].size(), SCALING_PORT);
+        bcast += rekeys[revoked++].size();
+    }, 1, victims.size());
+    r.revoke_bcast = double(bcast) / victims.size();
+
+    LkhWrapper wrapper;
+    for (const vector<uint8_t>& msg : rekeys) {
+        for (LkhMember& m : samples) {
+            auto start = chrono::steady_clock::now();
+            r.consistent &= m.apply(wrapper, msg.data(), msg.size()) >= 0;
+            r.member_ns.push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+        }
+    }
+    for (const LkhMember& m : samples) r.consistent &= m.group_key() == tree.keys[0];
+    return r;
+}
+
+void print_row(size_t fleet, const char* scheme, const SchemeResult& r) {
+    double sum = 0;
+    for (double t : r.member_ns) sum += t;
+    double member_max = r.member_ns.empty() ? 0 : *max_element(r.member_ns.begin(), r.member_ns.end());
+    printf("%-9zu %-6s %10.1f %9.0f %9.0f %10.1f %9.0f %11.2f %11.2f  %s\n", fleet, scheme, r.join.first / 1e3,
+           r.join_unicast, r.join_bcast, r.revoke.first / 1e3, r.revoke_bcast,
+           r.member_ns.empty() ? 0 : sum / r.member_ns.size() / 1e3, member_max / 1e3,
+           r.consistent ? "ok" : "INCONSISTENT");
+}
+
+int main(int argc, char** argv) {
+    size_t max_fleet = SCALING_MAX_FLEET;
+    int degree = LKH_DEGREE;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--max" && i + 1 < argc) max_fleet = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--degree" && i + 1 < argc) degree = max(2, atoi(argv[++i]));
+        else if (arg == "--broadcast") send_rekeys = true;
+        else {
+            cerr << "Usage: " << argv[0] << " [--max FLEET] [--degree D] [--broadcast]" << endl;
+            return 1;
+        }
+    }
+    if (core_init() != RLC_OK || pc_param_set_any() != RLC_OK) {
+        cerr << "RELIC initialization failed." << endl;
+        return 1;
+    }
+    ecu_init();
+
+    cout << "SGKD vs LKH (degree " << degree << "): " << SCALING_JOINS << " joins and up to " << SCALING_REVOKES
+         << " revocations per fleet size\n";
+    printf("%-9s %-6s %10s %9s %9s %10s %9s %11s %11s\n", "fleet", "scheme", "join_us", "join_uni", "join_bc",
+           "revoke_us", "revoke_bc", "member_us", "member_max");
+    for (size_t fleet = 10; fleet <= max_fleet; fleet *= 10) {
+        int revokes = min<size_t>(SCALING_REVOKES, fleet / 2);
+        int samples = min<size_t>(SCALING_MEMBER_SAMPLES, fleet - revokes);
+        vector<size_t> victims, sampled;
+        pick_members(fleet, revokes, samples, victims, sampled);
+        print_row(fleet, "sgkd", run_sgkd(fleet, victims));
+        print_row(fleet, "lkh", run_lkh(fleet, degree, victims, sampled));
+    }
+    core_clean();
+    return 0;
+}
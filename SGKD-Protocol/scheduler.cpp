@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+// TA work scheduler with priority classes and bounded admission.
+//
+// TA work falls into two classes. SCHED_URGENT holds control commands: revocations,
+// key refreshes and queries. SCHED_BULK holds registrations. Urgent work is always
+// taken first, so a revocation waits for at most the registrations already running,
+// not for every queued one.
+//
+// Bulk admission is bounded: while sched.bulk_max registrations are queued the serve
+// loop stops accepting, and further vehicles wait in the kernel's listen backlog
+// instead of in TA memory. Urgent work is never refused.
+
+#define SCHED_BULK_MAX 64
+
+enum SchedClass { SCHED_URGENT, SCHED_BULK, SCHED_CLASSES };
+
+struct SchedTask {
+    SchedClass cls;
+    std::chrono::steady_clock::time_point queued;
+    std::function<void()> run;
+};
+
+struct Scheduler {
+    size_t bulk_max = SCHED_BULK_MAX;
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<SchedTask> queue[SCHED_CLASSES];
+    size_t queued[SCHED_CLASSES] = {0, 0};
+    std::atomic<uint64_t> bulk_done{0};         // bulk tasks finished, for bounded runs
+};
+
+Scheduler sched;
+
+bool sched_bulk_full() {
+    std::lock_guard<std::mutex> guard(sched.lock);
+    return sched.queued[SCHED_BULK] >= sched.bulk_max;
+}
+
+bool sched_idle() {
+    std::lock_guard<std::mutex> guard(sched.lock);
+    return sched.queued[SCHED_URGENT] + sched.queued[SCHED_BULK] == 0;
+}
+
+// Queues run in class cls. Returns false, without queueing, if cls is SCHED_BULK and
+// the bulk class is full; the caller should stop admitting bulk work until it drains.
+bool sched_submit(SchedClass cls, std::function<void()> run) {
+    {
+        std::lock_guard<std::mutex> guard(sched.lock);
+        if (cls == SCHED_BULK && sched.queued[SCHED_BULK] >= sched.bulk_max) return false;
+        sched.queue[cls].push_back({cls, std::chrono::steady_clock::now(), std::move(run)});
+        sched.queued[cls]++;
+    }
+    sched.ready.notify_one();
+    return true;
+}
+
+// Takes the next task: the oldest urgent one, else the oldest bulk one. Caller holds
+// sched.lock and has checked for work.
+SchedTask sched_take() {
+    std::deque<SchedTask>& q = sched.queue[SCHED_URGENT].empty() ? sched.queue[SCHED_BULK] : sched.queue[SCHED_URGENT];
+    SchedTask task = std::move(q.front());
+    q.pop_front();
+    sched.queued[task.cls]--;
+    return task;
+}
+
+// Non-blocking: takes the next task if there is one. With urgent_only, takes only
+// urgent work.
+bool sched_try_pop(SchedTask& task, bool urgent_only = false) {
+    std::lock_guard<std::mutex> guard(sched.lock);
+    if (urgent_only && sched.queued[SCHED_URGENT] == 0) return false;
+    if (sched.queued[SCHED_URGENT] + sched.queued[SCHED_BULK] == 0) return false;
+    task = sched_take();
+    return true;
+}
+
+// Blocks until there is a task, for worker threads.
+SchedTask sched_wait_pop() {
+    std::unique_lock<std::mutex> guard(sched.lock);
+    sched.ready.wait(guard, [] { return sched.queued[SCHED_URGENT] + sched.queued[SCHED_BULK] > 0; });
+    return sched_take();
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <relic/relic.h>
+
+// In-process stand-in for the TA, used by the offline vehicle benchmarks.
+// It runs the same Setup/AddMember/RevokeMember arithmetic as ta.cpp and produces
+// key update datagrams in the broadcast wire format, so member-side code can be
+// benchmarked without a TA process or a network.
+struct SyntheticGroup {
+    uint32_t id = DEFAULT_GROUP;
+    uint64_t epoch = 0;
+    bn_t sk, ord;
+    g1_t h;
+    g2_t A;
+};
+
+void synthetic_setup(SyntheticGroup& grp) {
+    bn_null(grp.sk); bn_null(grp.ord); g1_null(grp.h); g2_null(grp.A);
+    bn_new(grp.sk); bn_new(grp.ord); g1_new(grp.h); g2_new(grp.A);
+    ep_curve_get_ord(grp.ord);
+    bn_rand_mod(grp.sk, grp.ord);
+    g1_rand(grp.h);
+    g2_rand(grp.A);
+}
+
+// Issues (x_i, w1 = h^{x_i + sk}, w2 = A^{1/(x_i + sk)}) for a new member.
+void synthetic_issue(SyntheticGroup& grp, bn_t x_i, g1_t w1, g2_t w2) {
+    bn_t temp;
+    bn_new(temp);
+    do {
+        bn_rand_mod(x_i, grp.ord);
+    } while (bn_is_zero(x_i));
+    bn_add(temp, x_i, grp.sk);
+    g1_mul(w1, grp.h, temp);
+    bn_mod_inv(temp, temp, grp.ord);
+    g2_mul(w2, grp.A, temp);
+    bn_free(temp);
+}
+
+// Revokes a fresh random x_r and writes the resulting key update datagram.
+// Returns the datagram length, or -1 if it does not fit in cap bytes.
+int synthetic_revoke(SyntheticGroup& grp, uint8_t* datagram, int cap) {
+    bn_t x_r, inv;
+    bn_new(x_r); bn_new(inv);
+    bn_rand_mod(x_r, grp.ord);
+    bn_add(inv, x_r, grp.sk);
+    bn_mod_inv(inv, inv, grp.ord);
+    g2_mul(grp.A, grp.A, inv);
+    int len = write_key_update(datagram, cap, grp.id, ++grp.epoch, grp.A, x_r);
+    bn_free(x_r); bn_free(inv);
+    return len;
+}
+
+void synthetic_free(SyntheticGroup& grp) {
+    bn_free(grp.sk); bn_free(grp.ord); g1_free(grp.h); g2_free(grp.A);
+}
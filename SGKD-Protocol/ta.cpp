@@ -12,38 +12,121 @@
 #include<utility>
 #include <cmath>
 #include <numeric>
+#include <poll.h>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <memory>
 #include"utils.cpp"
+#include"deterministic.cpp"
+#include"members.cpp"
+#include"replication.cpp"
+#include"auth.cpp"
+#include"epoch.cpp"
+#include"scheduler.cpp"
 using namespace std;
 
 #define PORT 9876
 #define ID_LEN 16
 #define BUF_SIZE 2048
 #define BROADCAST_PORT 9999
-#define BROADCAST_IP "255.255.255.255"
 #define ACK_PORT 9998
+#define CONTROL_PORT 9877
+#define REGISTRATION_TIMEOUT_MS 2000 // per send or receive on a registration connection
+#define METRICS_PORT 9100
+#define TRACE_FILE "ta-trace.json"
+#define UPDATE_LOG_MAX 4096 // key updates kept for vehicles catching up
 //compile and build it using:g++ ta.cpp -o ta   -I/usr/local/relic/include   -L/usr/local/relic/lib -lrelic_s   -lssl -lcrypto   -std=c++17
-// Global public parameters
+// Global public parameters. A and the epoch live in the current EpochSnapshot (epoch.cpp).
 g1_t g1, h;
-g2_t g2, A;
+g2_t g2;
 bn_t sk;
 bn_t xr;
+MemberTable members;
+std::mutex members_lock; // guards members and xr; never held across group operations
+AuthIdentity ta_auth;
+Bytes ticket_key;           // seals session tickets; replicated to the standby
+bool auth_required = false; // reject unauthenticated registrations
+uint32_t group_id = DEFAULT_GROUP; // --group; tags every key update this TA broadcasts
+int ta_port = PORT;                // --port; one TA per group needs its own ports, see ta_service_port
 
-void Setup() {
+// The TA's other ports keep their distance from the registration port, so TAs of
+// several groups share a host when their --port values are 10 apart (9876 to 9986).
+int ta_service_port(int base) { return base + ta_port - PORT; }
+
+Counter metric_registrations("sgkd_registrations_total", "Vehicles registered by the TA.");
+Counter metric_revocations("sgkd_revocations_total", "Revocations and group key refreshes issued by the TA.");
+Histogram metric_registration_latency("sgkd_registration_seconds", "TA-side AddMember latency.");
+Histogram metric_update_latency("sgkd_update_seconds", "TA-side RevokeMember latency including the broadcast.");
+Histogram metric_handshake_full("sgkd_handshake_full_seconds", "Full (certificate) registration handshake latency.");
+Histogram metric_handshake_resumed("sgkd_handshake_resumed_seconds", "Resumed (ticket) registration handshake latency.");
+Histogram metric_handshake_full_cpu("sgkd_handshake_full_cpu_seconds", "TA CPU time per full registration handshake.");
+Histogram metric_sched_wait_urgent("sgkd_sched_urgent_wait_seconds", "Time control commands (revocations) wait in the TA work queue.");
+Histogram metric_sched_wait_bulk("sgkd_sched_bulk_wait_seconds", "Time registrations wait in the TA work queue.");
+Counter metric_backpressure("sgkd_registration_backpressure_total", "Times the TA stopped accepting registrations because its queue was full.");
+Histogram metric_handshake_resumed_cpu("sgkd_handshake_resumed_cpu_seconds", "TA CPU time per resumed registration handshake.");
+
+// Initializes RELIC and allocates the global state without drawing parameters.
+void InitState() {
     if (core_init() != RLC_OK) handle_error("RELIC core init failed");
     if (pc_param_set_any() != RLC_OK) handle_error("Pairing params setup failed");
 
-    g1_null(g1); g1_null(h); g2_null(g2);g2_null(A);
-    bn_null(sk);
+    g1_null(g1); g1_null(h); g2_null(g2);
+    bn_null(sk); bn_null(xr);
+
+    g1_new(g1); g1_new(h); g2_new(g2);
+    bn_new(sk); bn_new(xr);
+}
+
+// Recent key update datagrams, for vehicles that missed some (HandleCatchUp). Entry i
+// started epoch update_log_first + i. Appended in epoch order under epoch_write_lock.
+std::mutex update_log_lock;
+std::deque<std::vector<uint8_t>> update_log;
+uint64_t update_log_first = 1;
+
+// Starts an empty log after epoch, e.g. at setup or from a replicated snapshot.
+void update_log_reset(uint64_t epoch) {
+    std::lock_guard<std::mutex> lock(update_log_lock);
+    update_log.clear();
+    update_log_first = epoch + 1;
+}
+void update_log_append(uint64_t epoch, const uint8_t* datagram, int len) {
+    std::lock_guard<std::mutex> lock(update_log_lock);
+    if (epoch != update_log_first + update_log.size()) {
+        update_log.clear();
+        update_log_first = epoch;
+    }
+    update_log.emplace_back(datagram, datagram + len);
+    if (update_log.size() > UPDATE_LOG_MAX) {
+        update_log.pop_front();
+        update_log_first++;
+    }
+}
+
+// Identifies this group instance, i.e. one run of Setup, for vehicles catching up
+// from a saved credential: SHA-256 over g1, h and g2. The standby computes the same
+// value from the replicated snapshot.
+uint8_t group_fingerprint[FINGERPRINT_LEN];
+void compute_group_fingerprint() {
+    std::vector<uint8_t> material = serialize_element(g1), b_h = serialize_element(h), b_g2 = serialize_element(g2);
+    material.insert(material.end(), b_h.begin(), b_h.end());
+    material.insert(material.end(), b_g2.begin(), b_g2.end());
+    SHA256(material.data(), material.size(), group_fingerprint);
+}
 
-    g1_new(g1); g1_new(h); g2_new(g2);g2_new(A);
-    bn_new(sk);
+void Setup() {
+    InitState();
+    seed_apply("ta");
 
     g1_rand(g1);
     g1_rand(h);
     g2_rand(g2);
 
     bn_t u, ord;
-    bn_new(u);
+    g2_t A;
+    bn_new(u); g2_new(A);
     bn_new(ord);
     ep_curve_get_ord(ord);     // Get group order p
     bn_rand_mod(u, ord);       // u ∈ Z_p
@@ -51,55 +134,47 @@ void Setup() {
 
     // A = g^u
     g2_mul(A, g2, u);
-    bn_new(xr);
-    bn_free(u);
+    transcript_note("setup.g1", g1);
+    transcript_note("setup.h", h);
+    transcript_note("setup.g2", g2);
+    transcript_note("setup.A", A);
+    transcript_note("setup.sk", sk);
+    compute_group_fingerprint();
+    update_log_reset(0);
+    std::lock_guard<std::mutex> lock(epoch_write_lock);
+    epoch_publish(epoch_make(0, A));
+    bn_free(u); g2_free(A);
 }
 
-void broadcast_key_update(const g2_t& A, const bn_t& x_r) {
+void broadcast_key_update(uint64_t epoch, const g2_t& A, const bn_t& x_r) {
+    TraceSpan span("broadcast.serialize");
     // 1. Prepare serialized data
     uint8_t buffer[4096];
-    int offset = 0;
-
-    // Serialize A
-    int len_A = g2_size_bin(A, 1);
-    g2_write_bin(buffer + offset, len_A, A, 1);
-    offset += len_A;
-
-    // Serialize x_r
-    int len_xr = bn_size_bin(x_r);
-    bn_write_bin(buffer + offset, len_xr, x_r);
-    offset += len_xr;
-
-    // 2. Create UDP socket
-    int sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sock < 0) {
-        perror("UDP socket creation failed");
-        return;
-    }
-
-    // 3. Enable broadcast
-    int broadcastEnable = 1;
-    if (setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &broadcastEnable, sizeof(broadcastEnable)) < 0) {
-        perror("setsockopt failed");
-        close(sock);
+    int offset = write_key_update(buffer, sizeof(buffer), group_id, epoch, A, x_r);
+    if (offset < 0) {
+        LOG_ERROR("Key update does not fit the broadcast buffer");
         return;
     }
+    update_log_append(epoch, buffer, offset);
 
-    // 4. Setup destination address
-    sockaddr_in dest{};
-    dest.sin_family = AF_INET;
-    dest.sin_port = htons(BROADCAST_PORT);
-    dest.sin_addr.s_addr = inet_addr(BROADCAST_IP);
-
-    // 5. Send the data
-    ssize_t sent = sendto(sock, buffer, offset, 0, (sockaddr*)&dest, sizeof(dest));
-    if (sent < 0) {
-        perror("Broadcast send failed");
-    } else {
-        std::cout << "[INFO] Key update broadcasted (" << sent << " bytes)" << std::endl;
+    // 2. Send the data
+    span.next("broadcast.sendto");
+    ssize_t sent = udp_broadcast(buffer, offset, BROADCAST_PORT);
+    if (sent >= 0)
+        LOG_INFO("Key update for group {} broadcasted ({} bytes)", group_id, sent);
+}
+// Sends the newest logged key update again. A promoted standby does this because the
+// old primary may have failed after replicating the update but before broadcasting it;
+// vehicles ignore a repeat.
+void rebroadcast_last_update() {
+    std::vector<uint8_t> datagram;
+    {
+        std::lock_guard<std::mutex> lock(update_log_lock);
+        if (update_log.empty()) return;
+        datagram = update_log.back();
     }
-
-    close(sock);
+    if (udp_broadcast(datagram.data(), datagram.size(), BROADCAST_PORT) >= 0)
+        LOG_INFO("Key update for group {} broadcast again ({} bytes)", group_id, datagram.size());
 }
 void receive_vehicle_acks() {
     int sock = socket(AF_INET, SOCK_DGRAM, 0);
@@ -110,7 +185,7 @@ void receive_vehicle_acks() {
 
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
-    addr.sin_port = htons(ACK_PORT);
+    addr.sin_port = htons(ta_service_port(ACK_PORT));
     addr.sin_addr.s_addr = INADDR_ANY;
 
     if (bind(sock, (sockaddr*)&addr, sizeof(addr)) < 0) {
@@ -124,74 +199,296 @@ void receive_vehicle_acks() {
     ssize_t len = recv(sock, buffer, sizeof(buffer) - 1, 0);
     if (len > 0) {
         buffer[len] = '\0';
-        std::cout << "[ACK RECEIVED] Vehicle ID: " << buffer << std::endl;
+        LOG_INFO("ACK received from vehicle ID: {}", buffer);
     }
     // }
 
     close(sock);
 }
 
-void AddMember(int sock) {
-    // 1. Receive 16-byte ID
-    char id[ID_LEN + 1] = {0};
-    recv(sock, id, ID_LEN, 0);
-    std::cout << "Registering vehicle with ID: " << id << std::endl;
-    std::cout<<"test1"<<std::endl;
-
-    // 2. Generate member secret xi
-    bn_t xi, temp, inv;
+// Draws a member secret xi for a new member and computes w1 = h^{xi + sk} and
+// w2 = A^{1/(xi + sk)} under the current epoch, which is returned in epoch. The member
+// is replicated and recorded before returning. Never waits for a revocation. Returns
+// false if this TA is fenced; the credential must then not be sent.
+bool IssueMember(const std::string& id, bn_t xi, g1_t w1, g2_t w2, uint64_t& epoch) {
+    TraceSpan span("AddMember.gen_xi");
+    bn_t temp, inv;
     bn_t ord;
     bn_new(ord);
     ep_curve_get_ord(ord);
-    bn_new(xi); bn_new(temp); bn_new(inv);
+    bn_new(temp); bn_new(inv);
     do{
     bn_rand_mod(xi, ord);
     }while (bn_is_zero(xi));
-    
-    
-    std::cout<<"test2"<<std::endl;
-    g1_t w1;
-    g2_t w2;
-    g1_new(w1); g2_new(w2);
-    
+
     // temp = xi + sk
     bn_add(temp, xi, sk);
-    std::cout<<"test3"<<std::endl;
     // w1 = h^{xi + sk}
+    span.next("AddMember.w1");
     g1_mul(w1, h, temp);
-    std::cout<<"test4"<<std::endl;
     // w2 = A^{1/(xi + sk)}
     // bn_gcd_ext(inv, NULL, NULL, temp, ord);
+    span.next("AddMember.inv");
     bn_mod_inv(inv, temp, ord);
-    std::cout<<"test5"<<std::endl;
-    g2_mul(w2, A, inv);
-    std::cout<<"test6"<<std::endl;
-    // 3. Send xi, w1, w2 to the vehicle
+    span.next("AddMember.w2");
+    {
+        EpochGuard snap;
+        g2_mul_fix(w2, snap->table, inv);
+        epoch = snap->epoch;
+    }
+    std::vector<uint8_t> secret = serialize_element(xi);
+    // The standby learns about the member before the vehicle gets its credential
+    span.next("AddMember.replicate");
+    ReplWriter rec;
+    rec.str(id);
+    rec.bytes(secret);
+    if (!repl_send(REPL_REGISTER, rec.buf)) {
+        bn_free(temp); bn_free(inv); bn_free(ord);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(members_lock);
+        members.add(id, std::move(secret));
+        bn_copy(xr, xi);
+    }
+    metric_registrations.inc();
+    transcript_note("register.xi", xi);
+    transcript_note("register.w1", w1);
+    transcript_note("register.w2", w2);
+    bn_free(temp); bn_free(inv); bn_free(ord);
+    return true;
+}
+// Recomputes the credential of an existing member under the current epoch, e.g. for a
+// vehicle that resumes after a reboot. Returns false if id is not a member.
+bool ReissueMember(const std::string& id, bn_t xi, g1_t w1, g2_t w2, uint64_t& epoch) {
+    std::vector<uint8_t> secret;
+    {
+        std::lock_guard<std::mutex> lock(members_lock);
+        const std::vector<uint8_t>* found = members.find(id);
+        if (!found) return false;
+        secret = *found;
+    }
+    TraceSpan span("ReissueMember");
+    bn_t temp, ord;
+    bn_new(temp); bn_new(ord);
+    ep_curve_get_ord(ord);
+    deserialize_element(xi, secret.data(), secret.size());
+    bn_add(temp, xi, sk);
+    g1_mul(w1, h, temp);
+    bn_mod_inv(temp, temp, ord);
+    {
+        EpochGuard snap;
+        g2_mul_fix(w2, snap->table, temp);
+        epoch = snap->epoch;
+    }
+    bn_free(temp); bn_free(ord);
+    return true;
+}
+void AddMember(int sock) {
+    HistogramTimer timer(metric_registration_latency);
+    TraceSpan total("AddMember");
+    TraceSpan span("AddMember.recv_id");
+    // 1. Receive 16-byte ID
+    char id[ID_LEN + 1] = {0};
+    if (recv(sock, id, ID_LEN, MSG_WAITALL) != ID_LEN) {
+        LOG_WARN("Registration dropped: no vehicle ID received");
+        return;
+    }
+    LOG_INFO("Registering vehicle with ID: {}", id);
+
+    // 2. Generate member secret xi and the credential
+    bn_t xi;
+    g1_t w1;
+    g2_t w2;
+    bn_new(xi); g1_new(w1); g2_new(w2);
+    uint64_t epoch;
+    if (!IssueMember(id, xi, w1, w2, epoch)) {
+        LOG_WARN("Registration of {} dropped: fenced", id);
+        bn_free(xi);
+        g1_free(w1); g2_free(w2);
+        return;
+    }
+
+    // 3. Send xi, w1, w2 and the epoch they were issued under to the vehicle
+    span.next("AddMember.send");
     send_bn(sock, xi);
-    std::cout<<"test7"<<std::endl;
     send_element(sock, w1);
-    std::cout<<"test8"<<std::endl;
     send_element(sock, w2);
-    std::cout<<"test9"<<std::endl;
-    bn_copy(xr,xi);
-    bn_free(xi); bn_free(temp); bn_free(inv);
-    g1_free(w1); g1_free(w2);
+    send_u64(sock, epoch);
+    bn_free(xi);
+    g1_free(w1); g2_free(w2);
 }
+// Authenticated registration (see auth.cpp). An existing member gets its credential
+// re-issued under the current A, so a second full handshake never replaces its x_i.
+// A full handshake admits a new member; a resumed one only serves existing members.
+void AuthenticatedAddMember(int sock) {
+    auto start = std::chrono::steady_clock::now();
+    double cpu_start = thread_cpu_ns();
+    TraceSpan total("AuthAddMember");
+    TraceSpan span("AuthAddMember.handshake");
+    uint8_t type = 0;
+    recv(sock, &type, 1, MSG_WAITALL);
+    AuthServerSession session;
+    bool ok = ta_auth.key && (type == HS_FULL ? auth_server_full(sock, ta_auth, session)
+                                               : auth_server_resume(sock, ticket_key, session));
+    if (!ok) {
+        LOG_WARN("Rejected registration: handshake type {} failed", (int)type);
+        return;
+    }
+    bool revoked;
+    {
+        std::lock_guard<std::mutex> lock(members_lock);
+        revoked = members.is_revoked(session.peer_id);
+    }
+    if (revoked) {
+        LOG_WARN("Rejected registration of revoked vehicle {}", session.peer_id);
+        return;
+    }
+    LOG_INFO("Registering vehicle with ID: {} ({} handshake)", session.peer_id, session.resumed ? "resumed" : "full");
+
+    span.next("AuthAddMember.credential");
+    bn_t xi;
+    g1_t w1;
+    g2_t w2;
+    bn_new(xi); g1_new(w1); g2_new(w2);
+    uint64_t epoch;
+    bool issued = false;
+    if (!ReissueMember(session.peer_id, xi, w1, w2, epoch)) {
+        if (session.resumed) {
+            LOG_WARN("Rejected resumption of {}: not a member, a full handshake is needed", session.peer_id);
+            bn_free(xi);
+            g1_free(w1); g2_free(w2);
+            return;
+        }
+        if (!IssueMember(session.peer_id, xi, w1, w2, epoch)) {
+            LOG_WARN("Registration of {} dropped: fenced", session.peer_id);
+            bn_free(xi);
+            g1_free(w1); g2_free(w2);
+            return;
+        }
+        issued = true;
+    }
+
+    span.next("AuthAddMember.send");
+    Bytes epoch_field(8);
+    put_u64(epoch_field.data(), epoch);
+    // The vehicle has confirmed the session, so the member stays on failure: its retry
+    // is re-issued the same x_i.
+    if (!auth_server_finish(sock, ticket_key, session,
+                            {serialize_element(xi), serialize_element(w1), serialize_element(w2), epoch_field}))
+        LOG_WARN("Could not deliver the {} credential of {}", issued ? "new" : "re-issued", session.peer_id);
+    bn_free(xi);
+    g1_free(w1); g2_free(w2);
 
-void RevokeMember(const bn_t& x_r) {
+    double cpu_ns = thread_cpu_ns() - cpu_start;
+    double wall_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    (session.resumed ? metric_handshake_resumed : metric_handshake_full).observe_ns(wall_ns);
+    (session.resumed ? metric_handshake_resumed_cpu : metric_handshake_full_cpu).observe_ns(cpu_ns);
+}
+// Sends a vehicle the group fingerprint and then the key updates after its epoch,
+// oldest first, or CATCHUP_GONE if they are no longer logged or the epoch is ahead of
+// this TA. Key updates are public broadcasts, so the request needs no authentication.
+void HandleCatchUp(int sock) {
+    uint8_t request[1 + 8];
+    if (recv(sock, request, sizeof(request), MSG_WAITALL) != (ssize_t)sizeof(request)) return;
+    uint64_t from = get_u64(request + 1);
+    std::vector<std::vector<uint8_t>> missed;
+    bool gone;
+    {
+        std::lock_guard<std::mutex> lock(update_log_lock);
+        uint64_t last = update_log_first + update_log.size() - 1;
+        gone = from + 1 < update_log_first || from > last;
+        if (!gone) missed.assign(update_log.begin() + (from + 1 - update_log_first), update_log.end());
+    }
+    int fp_len = FINGERPRINT_LEN;
+    send(sock, &fp_len, sizeof(fp_len), 0);
+    send(sock, group_fingerprint, fp_len, 0);
+    metric_bytes_sent.inc(sizeof(fp_len) + fp_len);
+    send_u64(sock, gone ? CATCHUP_GONE : missed.size());
+    for (const std::vector<uint8_t>& datagram : missed) {
+        int len = datagram.size();
+        send(sock, &len, sizeof(len), 0);
+        send(sock, datagram.data(), len, 0);
+        metric_bytes_sent.inc(sizeof(len) + len);
+    }
+    LOG_INFO("Catch-up from epoch {}: {}", from, gone ? "gone" : std::to_string(missed.size()) + " update(s)");
+}
+// Dispatches one registration connection. Authenticated handshakes and catch-up
+// requests start with a type byte; anything else is the legacy 16-byte vehicle ID.
+void HandleRegistration(int sock) {
+    if (repl_fenced()) return; // the standby serves the group now
+    uint8_t type = 0;
+    if (recv(sock, &type, 1, MSG_PEEK) != 1) return;
+    if (type == HS_FULL || type == HS_RESUME) {
+        AuthenticatedAddMember(sock);
+    } else if (type == CATCHUP_REQUEST) {
+        HandleCatchUp(sock);
+    } else if (auth_required) {
+        LOG_WARN("Rejected unauthenticated registration");
+    } else {
+        AddMember(sock);
+    }
+}
+
+// Revokes x_r and starts a new epoch. id names the revoked member, if it is known.
+// The next snapshot is built, replicated and published while registrations keep issuing
+// under the current one; revocations are serialized so updates go out in epoch order.
+// Publishing waits for the standby's acknowledgement, so no credential is issued under
+// an epoch the standby does not have.
+void RevokeMember(const bn_t& x_r, const std::string& id = "") {
+    HistogramTimer timer(metric_update_latency);
+    TraceSpan total("RevokeMember");
+    TraceSpan span("RevokeMember.inv");
     bn_t denom, inv, ord;
-    bn_new(denom); bn_new(inv); bn_new(ord);
+    g2_t A;
+    bn_new(denom); bn_new(inv); bn_new(ord); g2_new(A);
     ep_curve_get_ord(ord);
 
     bn_add(denom, x_r, sk);
     bn_mod_inv(inv, denom, ord);
 
-    g2_mul(A, A, inv); // A = A^{1/(x_r + sk)}
+    std::lock_guard<std::mutex> lock(epoch_write_lock);
+    span.next("RevokeMember.g2_mul");
+    const EpochSnapshot* prev = epoch_latest();
+    g2_mul_fix(A, prev->table, inv); // A = A^{1/(x_r + sk)}
+    EpochSnapshot* next = epoch_make(prev->epoch + 1, A);
 
-    // Broadcast A and x_r to all vehicles
-    broadcast_key_update(A, x_r);
+    span.next("RevokeMember.replicate");
+    ReplWriter rec;
+    rec.str(id);
+    rec.u64(next->epoch);
+    rec.bytes(serialize_element(next->A));
+    rec.bytes(serialize_element(x_r));
+    // A fenced TA keeps the epoch to itself: the standby either has it and
+    // rebroadcasts it on promotion, or never got it and nobody must see it.
+    if (!repl_send(REPL_REVOKE, rec.buf)) {
+        epoch_free(next);
+    } else {
+        span.next("RevokeMember.publish");
+        epoch_publish(next);
+        // Broadcast A and x_r to all vehicles
+        span.next("RevokeMember.broadcast");
+        broadcast_key_update(next->epoch, next->A, x_r);
+        metric_revocations.inc();
+        transcript_note("revoke.xr", x_r);
+        transcript_note("revoke.A", next->A);
+    }
 
-    bn_free(denom); bn_free(inv); bn_free(ord);
+    bn_free(denom); bn_free(inv); bn_free(ord); g2_free(A);
+}
+// Revokes a registered vehicle by ID. Returns false if the ID is not a current member.
+bool RevokeMemberById(const std::string& id) {
+    std::vector<uint8_t> secret;
+    {
+        std::lock_guard<std::mutex> lock(members_lock);
+        if (!members.take(id, secret)) return false;
+    }
+    bn_t x_r;
+    bn_new(x_r);
+    deserialize_element(x_r, secret.data(), secret.size());
+    RevokeMember(x_r, id);
+    bn_free(x_r);
+    return true;
 }
 void update()
 {
@@ -215,6 +512,23 @@ void update_benchmark()
     RevokeMember(xi);
     receive_vehicle_acks();
 }
+// Every socket this TA listens on. A fenced primary shuts them down, which frees the
+// ports for the standby while the descriptors stay valid for threads still using them.
+std::vector<int> ta_listeners;
+std::mutex ta_listeners_lock;
+bool listener_wait = false; // standby: wait for a fenced or failed primary to free the port
+
+void release_listeners() {
+    std::lock_guard<std::mutex> lock(ta_listeners_lock);
+    for (int fd : ta_listeners) shutdown(fd, SHUT_RDWR);
+}
+int track_listener(int fd) {
+    std::lock_guard<std::mutex> lock(ta_listeners_lock);
+    if (fd < 0) return fd;
+    ta_listeners.push_back(fd);
+    if (repl_fenced()) shutdown(fd, SHUT_RDWR); // fenced before the port was opened
+    return fd;
+}
 int setup_listener(int port) {
     int sockfd = socket(AF_INET, SOCK_STREAM, 0);
     if (sockfd < 0) handle_error("socket creation failed");
@@ -224,14 +538,359 @@ int setup_listener(int port) {
     addr.sin_port = htons(port);
     addr.sin_addr.s_addr = INADDR_ANY;
 
-    if (bind(sockfd, (sockaddr*)&addr, sizeof(addr)) < 0)
-        handle_error("bind failed");
+    int reuse = 1;
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    bool waiting = false;
+    while (bind(sockfd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        if (!listener_wait || errno != EADDRINUSE) handle_error("bind failed");
+        if (!waiting) LOG_WARN("Port {} is still in use, waiting for the old primary to release it", port);
+        waiting = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(REPL_HEARTBEAT_MS));
+    }
 
-    if (listen(sockfd, 5) < 0)
+    if (listen(sockfd, SOMAXCONN) < 0)
         handle_error("listen failed");
 
     std::cout << "Listening on port " << port << std::endl;
-    return sockfd;
+    return track_listener(sockfd);
+}
+// Accepts a registration connection. Each send and receive on it gives up after
+// REGISTRATION_TIMEOUT_MS, so a vehicle that connects and stalls cannot block the
+// thread running its registration, and with it the revocations queued behind it.
+int accept_registration(int listener) {
+    int sock = accept(listener, nullptr, nullptr);
+    if (sock < 0) return sock;
+    timeval timeout{REGISTRATION_TIMEOUT_MS / 1000, (REGISTRATION_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    return sock;
+}
+std::vector<uint8_t> encode_snapshot() {
+    ReplWriter w;
+    EpochGuard snap;
+    std::lock_guard<std::mutex> lock(members_lock);
+    w.u64(snap->epoch);
+    w.bytes(serialize_element(g1));
+    w.bytes(serialize_element(h));
+    w.bytes(serialize_element(g2));
+    w.bytes(serialize_element(snap->A));
+    w.bytes(serialize_element(sk));
+    w.bytes(serialize_element(xr));
+    w.u64(members.size());
+    for (auto& [id, secret] : members.secrets) {
+        w.str(id);
+        w.bytes(secret);
+    }
+    w.bytes(ticket_key);
+    w.u64(members.revoked.size());
+    for (const std::string& id : members.revoked) w.str(id);
+    return w.buf;
+}
+// Publishes a replicated epoch on the standby.
+void publish_replicated_epoch(uint64_t e, const std::vector<uint8_t>& b_A) {
+    g2_t A;
+    g2_new(A);
+    deserialize_element(A, b_A.data(), b_A.size());
+    std::lock_guard<std::mutex> lock(epoch_write_lock);
+    epoch_publish(epoch_make(e, A));
+    g2_free(A);
+}
+// Logs a replicated key update on the standby, so catch-up survives a failover.
+void log_replicated_update(uint64_t e, const std::vector<uint8_t>& b_A, const std::vector<uint8_t>& b_xr) {
+    g2_t A;
+    bn_t x_r;
+    g2_new(A); bn_new(x_r);
+    deserialize_element(A, b_A.data(), b_A.size());
+    deserialize_element(x_r, b_xr.data(), b_xr.size());
+    uint8_t buffer[4096];
+    int len = write_key_update(buffer, sizeof(buffer), group_id, e, A, x_r);
+    if (len > 0) update_log_append(e, buffer, len);
+    g2_free(A); bn_free(x_r);
+}
+// Applies one replicated record on the standby. Records are decoded in full before
+// any state changes, so a malformed record leaves the state untouched.
+bool snapshot_received = false;
+void apply_replicated(ReplRecordType type, const std::vector<uint8_t>& payload) {
+    ReplReader r(payload);
+    switch (type) {
+    case REPL_SNAPSHOT: {
+        uint64_t e = r.u64();
+        std::vector<uint8_t> b_g1 = r.bytes(), b_h = r.bytes(), b_g2 = r.bytes(), b_A = r.bytes();
+        std::vector<uint8_t> b_sk = r.bytes(), b_xr = r.bytes();
+        uint64_t n = r.u64();
+        MemberTable table;
+        for (uint64_t i = 0; i < n && r.ok; ++i) {
+            std::string id = r.str();
+            table.add(id, r.bytes());
+        }
+        std::vector<uint8_t> tk = r.bytes();
+        uint64_t n_revoked = r.u64();
+        for (uint64_t i = 0; i < n_revoked && r.ok; ++i) table.revoked.insert(r.str());
+        if (!r.ok) break;
+        publish_replicated_epoch(e, b_A);
+        update_log_reset(e);
+        deserialize_element(g1, b_g1.data(), b_g1.size());
+        deserialize_element(h, b_h.data(), b_h.size());
+        deserialize_element(g2, b_g2.data(), b_g2.size());
+        compute_group_fingerprint();
+        deserialize_element(sk, b_sk.data(), b_sk.size());
+        deserialize_element(xr, b_xr.data(), b_xr.size());
+        members = std::move(table);
+        ticket_key = std::move(tk);
+        snapshot_received = true;
+        return;
+    }
+    case REPL_REGISTER: {
+        std::string id = r.str();
+        std::vector<uint8_t> secret = r.bytes();
+        if (!r.ok) break;
+        deserialize_element(xr, secret.data(), secret.size());
+        members.add(id, std::move(secret));
+        return;
+    }
+    case REPL_REVOKE: {
+        std::string id = r.str();
+        uint64_t e = r.u64();
+        std::vector<uint8_t> b_A = r.bytes(), b_xr = r.bytes();
+        if (!r.ok) break;
+        std::vector<uint8_t> unused;
+        if (!id.empty()) members.take(id, unused);
+        publish_replicated_epoch(e, b_A);
+        log_replicated_update(e, b_A, b_xr);
+        return;
+    }
+    default:
+        break;
+    }
+    LOG_ERROR("Ignored malformed replication record of type {}", (int)type);
+}
+// Executes one line of the control protocol used by the workload driver:
+//   REVOKE <id> | REFRESH | STATS   ->   "OK ..." or "ERR <reason>"
+// A fenced TA answers everything with "ERR fenced".
+std::string handle_control(const std::string& line) {
+    if (repl_fenced()) return "ERR fenced\n";
+    if (line.rfind("REVOKE ", 0) == 0) {
+        if (!RevokeMemberById(line.substr(7))) return "ERR unknown member\n";
+        return repl_fenced() ? "ERR fenced\n" : "OK\n";
+    }
+    if (line == "REFRESH") {
+        update();
+        return repl_fenced() ? "ERR fenced\n" : "OK\n";
+    }
+    if (line == "STATS") {
+        EpochGuard snap;
+        std::lock_guard<std::mutex> lock(members_lock);
+        return "OK members=" + std::to_string(members.size()) + " epoch=" + std::to_string(snap->epoch) + "\n";
+    }
+    return "ERR bad command\n";
+}
+// Workers (--workers N). The serve thread accepts connections and queues their work
+// with the scheduler; workers take it in scheduler order, and the serve thread also
+// runs urgent work itself, so a revocation publishing a new epoch and the
+// registrations pinning the current one run side by side.
+#if defined(MULTI) && defined(PTHREAD) && MULTI == PTHREAD
+#define RELIC_THREADS 1
+#else
+#define RELIC_THREADS 0
+#endif
+int registration_workers = 0;
+bool use_scheduler = true; // false (--no-scheduler): the inline loop below, as before the scheduler
+
+void sched_run(SchedTask& task) {
+    auto waited = std::chrono::steady_clock::now() - task.queued;
+    (task.cls == SCHED_URGENT ? metric_sched_wait_urgent : metric_sched_wait_bulk)
+        .observe_ns(std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count());
+    task.run();
+    if (task.cls == SCHED_BULK) sched.bulk_done++;
+}
+void sched_worker() {
+    // Every thread needs its own RELIC context (RELIC built with MULTI=PTHREAD).
+    if (core_init() != RLC_OK || pc_param_set_any() != RLC_OK) handle_error("RELIC init failed in a worker");
+    while (true) {
+        SchedTask task = sched_wait_pop();
+        sched_run(task);
+    }
+}
+void start_workers() {
+    static bool started = false;
+    if (started) return;
+    started = true;
+    if (registration_workers > 0 && !RELIC_THREADS)
+        handle_error("--workers needs RELIC built with -DMULTI=PTHREAD");
+    for (int i = 0; i < registration_workers; ++i) std::thread(sched_worker).detach();
+}
+int control_listener() {
+    static int control = setup_listener(ta_service_port(CONTROL_PORT));
+    return control;
+}
+// A control connection. Queued commands share it, so the socket stays open until
+// their replies are sent even if the client hangs up first.
+struct ControlClient {
+    int fd;
+    std::string in;
+    explicit ControlClient(int f) : fd(f) {}
+    ~ControlClient() { close(fd); }
+};
+// Accepts registrations on listener and control commands on CONTROL_PORT and queues
+// them with the scheduler (scheduler.cpp). Without --workers this thread also runs the
+// queue, at most one registration per poll round, so all RELIC calls stay on this
+// thread. Runs until `registrations` more registrations have finished, or forever if
+// negative.
+void serve_loop(int listener, long registrations) {
+    int control = control_listener();
+    std::vector<pollfd> fds = {{listener, POLLIN, 0}, {control, POLLIN, 0}};
+    std::unordered_map<int, std::shared_ptr<ControlClient>> clients;
+    uint64_t done_at = sched.bulk_done + std::max(registrations, 0L);
+    long to_accept = registrations;
+    bool paused = false;
+    SchedTask task;
+
+    while (registrations < 0 || sched.bulk_done < done_at) {
+        // Backpressure: leave new registrations in the listen backlog while the queue is full.
+        bool full = sched_bulk_full();
+        if (full && !paused) metric_backpressure.inc();
+        paused = full;
+        fds[0].events = full || to_accept == 0 ? 0 : POLLIN;
+        if (repl_fenced()) fds[0].fd = fds[1].fd = -1; // listeners released for the standby
+        int timeout = registrations < 0 ? -1 : 50;
+        if (registration_workers == 0 && !sched_idle()) timeout = 0;
+        if (poll(fds.data(), fds.size(), timeout) < 0) {
+            if (errno == EINTR) continue;
+            handle_error("poll failed");
+        }
+        for (size_t i = 2; i < fds.size();) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) { ++i; continue; }
+            char buf[512];
+            ssize_t n = recv(fds[i].fd, buf, sizeof(buf), 0);
+            if (n <= 0) {
+                clients.erase(fds[i].fd);
+                fds.erase(fds.begin() + i);
+                continue;
+            }
+            std::shared_ptr<ControlClient> client = clients[fds[i].fd];
+            client->in.append(buf, n);
+            size_t nl;
+            while ((nl = client->in.find('\n')) != std::string::npos) {
+                std::string line = client->in.substr(0, nl);
+                client->in.erase(0, nl + 1);
+                sched_submit(SCHED_URGENT, [client, line] {
+                    std::string reply = handle_control(line);
+                    send(client->fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+                });
+            }
+            ++i;
+        }
+        if (fds[0].revents & POLLIN) {
+            int sock = accept_registration(listener);
+            if (sock >= 0 && sched_submit(SCHED_BULK, [sock] {
+                    HandleRegistration(sock);
+                    close(sock);
+                })) {
+                if (to_accept > 0) to_accept--;
+            } else if (sock >= 0) {
+                close(sock);
+            }
+        }
+        if (fds[1].revents & POLLIN) {
+            int client = accept(control, nullptr, nullptr);
+            if (client >= 0) {
+                clients[client] = std::make_shared<ControlClient>(client);
+                fds.push_back({client, POLLIN, 0});
+            }
+        }
+        if (registration_workers == 0) {
+            while (sched_try_pop(task)) {
+                sched_run(task);
+                if (task.cls == SCHED_BULK) break;
+            }
+        } else {
+            while (sched_try_pop(task, true)) sched_run(task);
+        }
+    }
+    if (registration_workers == 0)
+        while (sched_try_pop(task)) sched_run(task);
+}
+// The TA as it was before the scheduler, kept as the --no-scheduler baseline. Control
+// commands run inline as they arrive; each poll round accepts one registration and
+// runs it inline, or hands it to the workers in arrival order without a queue bound.
+void serve_inline(int listener) {
+    int control = control_listener();
+    std::vector<pollfd> fds = {{listener, POLLIN, 0}, {control, POLLIN, 0}};
+    std::unordered_map<int, std::string> pending;
+
+    while (true) {
+        if (repl_fenced()) fds[0].fd = fds[1].fd = -1; // listeners released for the standby
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            handle_error("poll failed");
+        }
+        for (size_t i = 2; i < fds.size();) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) { ++i; continue; }
+            char buf[512];
+            ssize_t n = recv(fds[i].fd, buf, sizeof(buf), 0);
+            if (n <= 0) {
+                close(fds[i].fd);
+                pending.erase(fds[i].fd);
+                fds.erase(fds.begin() + i);
+                continue;
+            }
+            std::string& in = pending[fds[i].fd];
+            in.append(buf, n);
+            size_t nl;
+            while ((nl = in.find('\n')) != std::string::npos) {
+                std::string reply = handle_control(in.substr(0, nl));
+                in.erase(0, nl + 1);
+                send(fds[i].fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+            }
+            ++i;
+        }
+        if (fds[0].revents & POLLIN) {
+            int sock = accept_registration(listener);
+            if (sock >= 0 && registration_workers > 0) {
+                sched_submit(SCHED_BULK, [sock] {
+                    HandleRegistration(sock);
+                    close(sock);
+                });
+            } else if (sock >= 0) {
+                HandleRegistration(sock);
+                close(sock);
+            }
+        }
+        if (fds[1].revents & POLLIN) {
+            int client = accept(control, nullptr, nullptr);
+            if (client >= 0) fds.push_back({client, POLLIN, 0});
+        }
+    }
+}
+// Non-interactive mode: serves registrations and control commands until killed.
+void serve(int listener) {
+    start_workers();
+    if (use_scheduler) {
+        serve_loop(listener, -1);
+        return;
+    }
+    // Workers still drain the scheduler, which holds only registrations here.
+    sched.bulk_max = SIZE_MAX;
+    serve_inline(listener);
+}
+// Runs as a hot standby until the primary fails, then takes over its ports. Only
+// primary_host may connect, or only loopback if it is empty.
+int run_standby(const std::string& primary_host) {
+    InitState();
+    listener_wait = true;
+    double silent_ms = 0;
+    repl_follow(apply_replicated, silent_ms, ta_service_port(REPL_PORT), primary_host);
+    if (!snapshot_received) handle_error("primary failed before sending its state");
+    auto start = std::chrono::steady_clock::now();
+    int listener = setup_listener(ta_port);
+    double takeover_ms = silent_ms + std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "[INFO] Promoted to primary at epoch " << epoch_latest()->epoch << " with " << members.size()
+              << " members, " << takeover_ms << " ms after the last record from the old primary" << std::endl;
+    rebroadcast_last_update();
+    track_listener(metrics_serve(ta_service_port(METRICS_PORT)));
+    serve(listener);
+    return 0;
 }
 void showoptionmenu()
 {
@@ -243,11 +902,70 @@ void showoptionmenu()
     std::cout<<"|   4- Benchmark Vehicle Registration          |"<<std::endl;
     std::cout<<"|   5- Benchmark The Group Key Update          |"<<std::endl;
     std::cout<<"|   6- Benchmark ACK Latency                   |"<<std::endl;
+    std::cout<<"|   7- Export Phase Trace (Chrome JSON)        |"<<std::endl;
     std::cout<<"================================================"<<std::endl;
 }
-int main() {
+int main(int argc, char** argv) {
+    bool serve_mode = false, standby_mode = false;
+    std::string standby_host, primary_host, auth_dir, repl_key_file;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--provision" && i + 1 < argc) {
+            std::vector<std::string> ids(argv + i + 2, argv + argc);
+            if (!auth_provision(argv[i + 1], ids)) handle_error("provisioning failed");
+            std::cout << "[INFO] Issued certificates for the TA and " << ids.size() << " vehicles in " << argv[i + 1] << std::endl;
+            return 0;
+        } else if (arg == "--auth" && i + 1 < argc) {
+            auth_dir = argv[++i];
+        } else if (arg == "--serve") {
+            serve_mode = true;
+        } else if (arg == "--standby") {
+            standby_mode = true;
+        } else if (arg == "--primary" && i + 1 < argc) {
+            standby_host = argv[++i];
+        } else if (arg == "--peer" && i + 1 < argc) {
+            primary_host = argv[++i];
+        } else if (arg == "--repl-key" && i + 1 < argc) {
+            repl_key_file = argv[++i];
+        } else if (arg == "--group" && i + 1 < argc) {
+            group_id = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--port" && i + 1 < argc) {
+            ta_port = atoi(argv[++i]);
+        } else if (arg == "--workers" && i + 1 < argc) {
+            registration_workers = max(0, atoi(argv[++i]));
+        } else if (arg == "--no-scheduler") {
+            use_scheduler = false;
+        } else if (arg == "--queue" && i + 1 < argc) {
+            sched.bulk_max = max(1, atoi(argv[++i]));
+        } else if (!parse_deterministic_option(argc, argv, i)) {
+            std::cerr << "Usage: " << argv[0] << " [--serve] [--primary STANDBY_HOST | --standby [--peer PRIMARY_HOST]] [--repl-key FILE] [--auth DIR]"
+                      << " [--group ID] [--port P] [--workers N] [--no-scheduler] [--queue N] [--seed S] [--record FILE | --check FILE]" << std::endl
+                      << "       " << argv[0] << " --provision DIR VEHICLE_ID..." << std::endl;
+            return 1;
+        }
+    }
+    // Workers have their own unseeded RELIC RNG and would write the transcript
+    // concurrently, so seeded and transcript runs stay on one thread.
+    if (registration_workers > 0 && (!run_seed.empty() || transcript_file))
+        handle_error("--workers cannot be combined with --seed, --record or --check");
+    if (!auth_dir.empty()) {
+        if (!auth_load_identity(auth_dir, "ta", ta_auth)) handle_error("cannot load the TA identity from " + auth_dir);
+        auth_required = true;
+    }
+    if ((standby_mode || !standby_host.empty()) && !repl_load_key(repl_key_file))
+        handle_error("replication needs --repl-key FILE holding a 32-byte key");
+    ticket_key = auth_random(AUTH_KEY_LEN);
+    if (standby_mode) return run_standby(primary_host);
     Setup();
-    int listener = setup_listener(PORT);
+    if (!standby_host.empty()) {
+        if (!repl_connect(standby_host, ta_service_port(REPL_PORT))) handle_error("cannot reach the standby at " + standby_host);
+        repl_on_fence = release_listeners;
+        if (!repl_send(REPL_SNAPSHOT, encode_snapshot())) handle_error("the standby did not take the snapshot");
+        std::cout << "[INFO] Replicating to standby " << standby_host << ":" << ta_service_port(REPL_PORT) << std::endl;
+    }
+    int listener = setup_listener(ta_port);
+    track_listener(metrics_serve(ta_service_port(METRICS_PORT)));
+    if (serve_mode) serve(listener);
 
     while (true) {
         showoptionmenu();
@@ -256,15 +974,22 @@ int main() {
         switch (n)
         {
         case 1:{
-            int sock = accept(listener, nullptr, nullptr);
+            int sock = accept_registration(listener);
             if (sock >= 0) {
-                AddMember(sock);
+                HandleRegistration(sock);
                 close(sock);
             }
             break;
         }
         case 2:{
-            RevokeMember(xr);
+            bn_t last;
+            bn_new(last);
+            {
+                std::lock_guard<std::mutex> lock(members_lock);
+                bn_copy(last, xr);
+            }
+            RevokeMember(last);
+            bn_free(last);
             break;
         }
         case 3:{
@@ -275,11 +1000,18 @@ int main() {
             cout<<"Please enter the total number of registration:"<<endl;
             int totalregistrations=1;
             cin>>totalregistrations;
+            if (use_scheduler) {
+                // Keep serving revocations on the control port during the run.
+                cout<<"Revocations are accepted on port "<<ta_service_port(CONTROL_PORT)<<" meanwhile."<<endl;
+                start_workers();
+                serve_loop(listener, max(totalregistrations, 0));
+                break;
+            }
             for (size_t i = 0; i < totalregistrations; i++)
             {
-               int sock = accept(listener, nullptr, nullptr);
+               int sock = accept_registration(listener);
                 if (sock >= 0) {
-                    AddMember(sock);
+                    HandleRegistration(sock);
                     close(sock);
                 }
             }
@@ -289,6 +1021,7 @@ int main() {
         case 5:{
             auto [updatelatency_avg, updatelatency_std] = benchmark_stats(update_benchmark);
             cout << "Registration Total Latency:" << updatelatency_avg << " ns (±" << updatelatency_std << ")\n";
+            perf_report("ta_key_update", updatelatency_avg, updatelatency_std);
             
             break;
         }
@@ -302,6 +1035,15 @@ int main() {
                 receive_vehicle_acks();
             }
             
+            break;
+        }
+        case 7:
+        {
+            if (trace_write_chrome(TRACE_FILE))
+                cout << "Trace written to " << TRACE_FILE << endl;
+            else
+                perror("trace export failed");
+            break;
         }
         default:
             break;
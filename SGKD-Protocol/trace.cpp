@@ -0,0 +1,311 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Phase tracing and metrics shared by the TA and the vehicle.
+//
+// Spans are recorded into a per-thread ring buffer (single writer, no locks on the
+// hot path) with raw TSC timestamps. The rings are only read when a trace is exported
+// as Chrome trace JSON (load it in chrome://tracing or https://ui.perfetto.dev).
+// Counters and histograms are plain atomics and are rendered in the Prometheus text
+// format by a small HTTP server bound to a local port:
+//   GET /metrics -> Prometheus text
+//   GET /trace   -> Chrome trace JSON
+// Build with -DSGKD_TRACE=0 to compile the span recording out.
+
+#ifndef SGKD_TRACE
+#define SGKD_TRACE 1
+#endif
+
+#define TRACE_RING_SIZE 8192 // events kept per thread, must be a power of two
+
+inline uint64_t trace_clock() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline uint64_t trace_wall_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct TraceEvent {
+    const char* name; // string literal, never freed
+    uint64_t begin;
+    uint64_t end;
+};
+
+struct TraceRing {
+    TraceEvent events[TRACE_RING_SIZE];
+    std::atomic<uint64_t> head{0};
+    uint32_t tid = 0;
+};
+
+// Reference point for converting TSC ticks to wall-clock time at export.
+static uint64_t trace_origin_tsc = trace_clock();
+static uint64_t trace_origin_ns = trace_wall_ns();
+
+inline std::mutex& trace_registry_mutex() {
+    static std::mutex m;
+    return m;
+}
+
+inline std::vector<TraceRing*>& trace_registry() {
+    static std::vector<TraceRing*> rings;
+    return rings;
+}
+
+inline TraceRing* trace_local_ring() {
+    // Rings outlive their threads so late exports still see their events.
+    thread_local TraceRing* ring = [] {
+        TraceRing* r = new TraceRing();
+        std::lock_guard<std::mutex> lock(trace_registry_mutex());
+        r->tid = trace_registry().size() + 1;
+        trace_registry().push_back(r);
+        return r;
+    }();
+    return ring;
+}
+
+inline void trace_record(const char* name, uint64_t begin, uint64_t end) {
+#if SGKD_TRACE
+    TraceRing* ring = trace_local_ring();
+    uint64_t idx = ring->head.load(std::memory_order_relaxed);
+    ring->events[idx & (TRACE_RING_SIZE - 1)] = {name, begin, end};
+    ring->head.store(idx + 1, std::memory_order_release);
+#else
+    (void)name; (void)begin; (void)end;
+#endif
+}
+
+// Scoped span. next() closes the current phase and opens the following one, so a
+// function can be split into consecutive phases without nesting blocks.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name) : name_(name), begin_(trace_clock()) {}
+    ~TraceSpan() { trace_record(name_, begin_, trace_clock()); }
+    void next(const char* name) {
+        uint64_t now = trace_clock();
+        trace_record(name_, begin_, now);
+        name_ = name;
+        begin_ = now;
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+private:
+    const char* name_;
+    uint64_t begin_;
+};
+
+std::string trace_chrome_json() {
+    uint64_t now_tsc = trace_clock();
+    uint64_t now_ns = trace_wall_ns();
+    double ns_per_tick = (now_tsc > trace_origin_tsc)
+        ? double(now_ns - trace_origin_ns) / double(now_tsc - trace_origin_tsc) : 1.0;
+
+    std::vector<TraceRing*> rings;
+    {
+        std::lock_guard<std::mutex> lock(trace_registry_mutex());
+        rings = trace_registry();
+    }
+
+    std::string out = "{\"traceEvents\":[";
+    bool first = true;
+    char line[256];
+    int pid = getpid();
+    for (TraceRing* ring : rings) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t start = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+        std::vector<TraceEvent> copy;
+        copy.reserve(head - start);
+        for (uint64_t i = start; i < head; ++i) copy.push_back(ring->events[i & (TRACE_RING_SIZE - 1)]);
+        // Drop the slots the writer may have overwritten while we were copying. That
+        // includes slot head_after, which it may be writing but has not yet published.
+        uint64_t head_after = ring->head.load(std::memory_order_acquire);
+        size_t skip = 0;
+        if (head_after >= TRACE_RING_SIZE && head_after - TRACE_RING_SIZE >= start)
+            skip = std::min<uint64_t>(head_after - TRACE_RING_SIZE + 1 - start, copy.size());
+
+        for (size_t i = skip; i < copy.size(); ++i) {
+            const TraceEvent& ev = copy[i];
+            double ts_us = (double(ev.begin - trace_origin_tsc) * ns_per_tick) / 1000.0;
+            double dur_us = (double(ev.end - ev.begin) * ns_per_tick) / 1000.0;
+            snprintf(line, sizeof(line),
+                     "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u}",
+                     first ? "" : ",\n", ev.name, ts_us, dur_us, pid, ring->tid);
+            out += line;
+            first = false;
+        }
+    }
+    out += "],\"displayTimeUnit\":\"ns\"}\n";
+    return out;
+}
+
+bool trace_write_chrome(const std::string& path) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) return false;
+    std::string json = trace_chrome_json();
+    fwrite(json.data(), 1, json.size(), f);
+    fclose(f);
+    return true;
+}
+
+// Converts a TSC interval measured on this thread to nanoseconds.
+inline uint64_t trace_ticks_to_ns(uint64_t ticks) {
+    uint64_t now_tsc = trace_clock();
+    uint64_t now_ns = trace_wall_ns();
+    if (now_tsc <= trace_origin_tsc) return ticks;
+    return uint64_t(double(ticks) * double(now_ns - trace_origin_ns) / double(now_tsc - trace_origin_tsc));
+}
+
+struct Metric {
+    const char* name;
+    const char* help;
+    virtual void render(std::string& out) const = 0;
+    Metric(const char* n, const char* h);
+    virtual ~Metric() = default;
+};
+
+inline std::vector<Metric*>& metrics_registry() {
+    static std::vector<Metric*> metrics;
+    return metrics;
+}
+
+Metric::Metric(const char* n, const char* h) : name(n), help(h) {
+    metrics_registry().push_back(this);
+}
+
+struct Counter : Metric {
+    std::atomic<uint64_t> value{0};
+    Counter(const char* n, const char* h) : Metric(n, h) {}
+    void inc(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    void render(std::string& out) const override {
+        out += "# HELP " + std::string(name) + " " + help + "\n";
+        out += "# TYPE " + std::string(name) + " counter\n";
+        out += std::string(name) + " " + std::to_string(value.load(std::memory_order_relaxed)) + "\n";
+    }
+};
+
+// Latency histogram with fixed bucket bounds in seconds.
+struct Histogram : Metric {
+    static constexpr int NBUCKETS = 12;
+    static constexpr double bounds[NBUCKETS] = {
+        1e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2, 5e-2, 1e-1, 1.0};
+    std::atomic<uint64_t> buckets[NBUCKETS + 1]{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum_ns{0};
+    Histogram(const char* n, const char* h) : Metric(n, h) {}
+
+    void observe_ns(uint64_t ns) {
+        double s = ns / 1e9;
+        int i = 0;
+        while (i < NBUCKETS && s > bounds[i]) ++i;
+        buckets[i].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum_ns.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    void render(std::string& out) const override {
+        char line[256];
+        out += "# HELP " + std::string(name) + " " + help + "\n";
+        out += "# TYPE " + std::string(name) + " histogram\n";
+        uint64_t cumulative = 0;
+        for (int i = 0; i < NBUCKETS; ++i) {
+            cumulative += buckets[i].load(std::memory_order_relaxed);
+            snprintf(line, sizeof(line), "%s_bucket{le=\"%g\"} %llu\n", name, bounds[i],
+                     (unsigned long long)cumulative);
+            out += line;
+        }
+        cumulative += buckets[NBUCKETS].load(std::memory_order_relaxed);
+        snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %.9f\n%s_count %llu\n",
+                 name, (unsigned long long)cumulative, name,
+                 sum_ns.load(std::memory_order_relaxed) / 1e9, name,
+                 (unsigned long long)count.load(std::memory_order_relaxed));
+        out += line;
+    }
+};
+
+// Times a scope in TSC ticks and feeds the histogram on exit.
+class HistogramTimer {
+public:
+    explicit HistogramTimer(Histogram& h) : hist_(h), begin_(trace_clock()) {}
+    ~HistogramTimer() { hist_.observe_ns(trace_ticks_to_ns(trace_clock() - begin_)); }
+private:
+    Histogram& hist_;
+    uint64_t begin_;
+};
+
+std::string metrics_render() {
+    std::string out;
+    for (const Metric* m : metrics_registry()) m->render(out);
+    return out;
+}
+
+// Serves /metrics and /trace on 127.0.0.1:port from a background thread and returns
+// the listening socket; shutting it down stops the endpoint and frees the port.
+// Failing to bind (e.g. a second vehicle on the same host) only disables the endpoint.
+int metrics_serve(int port) {
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd < 0) {
+        perror("metrics socket creation failed");
+        return -1;
+    }
+    int reuse = 1;
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(sockfd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(sockfd, 4) < 0) {
+        perror("metrics endpoint disabled");
+        close(sockfd);
+        return -1;
+    }
+
+    std::thread([sockfd] {
+        char req[1024];
+        while (true) {
+            int client = accept(sockfd, nullptr, nullptr);
+            if (client < 0 && errno == EINVAL) break; // shut down
+            if (client < 0) continue;
+            ssize_t n = recv(client, req, sizeof(req) - 1, 0);
+            req[n > 0 ? n : 0] = '\0';
+
+            bool want_trace = strncmp(req, "GET /trace", 10) == 0;
+            std::string body = want_trace ? trace_chrome_json() : metrics_render();
+            std::string resp = "HTTP/1.0 200 OK\r\nContent-Type: ";
+            resp += want_trace ? "application/json" : "text/plain; version=0.0.4";
+            resp += "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+            resp += body;
+
+            size_t off = 0;
+            while (off < resp.size()) {
+                ssize_t w = send(client, resp.data() + off, resp.size() - off, MSG_NOSIGNAL);
+                if (w <= 0) break;
+                off += w;
+            }
+            close(client);
+        }
+        close(sockfd);
+    }).detach();
+    return sockfd;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <relic/relic.h>
+
+// Member w2 update kernel.
+//
+// A key update maps w2 to A_new^e / w2^e with e = 1 / (x_i - x_r). In additive
+// notation that is e * (A_new - w2), so one G2 subtraction and one scalar
+// multiplication replace two multiplications, a negation and an addition. The
+// remaining g2_mul uses RELIC's configured method (GLS-wNAF on the BN and BLS curves).
+// scratch is allocated once by the caller and must not alias w2 or A_new; the kernel
+// allocates nothing.
+void g2_update_w2(g2_t w2, const g2_t A_new, const bn_t e, g2_t scratch) {
+    g2_sub(scratch, A_new, w2);
+    g2_mul(w2, scratch, e);
+}
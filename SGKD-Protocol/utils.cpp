@@ -3,14 +3,32 @@
 #include <iostream>
 #include <relic/relic_pc.h>
 #include <sys/socket.h>
+#include <arpa/inet.h>
+#include <unistd.h>
 #include <vector>
+#include <cstring>
+#include <ctime>
+#include <openssl/sha.h>
+#include"trace.cpp"
+#include"log.cpp"
+#include"perf.cpp"
+#include"update_kernel.cpp"
 using namespace std;
 #define BUF_SIZE 2048
+#define MAX_ELEMENT_LEN 1024 // largest serialized element accepted from a peer
+#define MAX_SCALAR_LEN 64    // largest serialized bn_t accepted from a peer
+#define KEY_UPDATE_HEADER_LEN 12 // group ID and epoch prefix of a key update datagram
+#define DEFAULT_GROUP 0
+#define CATCHUP_REQUEST 0x03         // on the registration port: type (1) | epoch (8), big endian
+#define CATCHUP_GONE UINT64_MAX      // catch-up reply: the TA no longer has the missed updates
+#define FINGERPRINT_LEN SHA256_DIGEST_LENGTH // group instance ID leading every catch-up reply
+Counter metric_bytes_sent("sgkd_bytes_sent_total", "Bytes written to registration sockets and key update broadcasts.");
 template <typename F>
 pair<double, double> benchmark_stats(F func, int inner_loop = 1000, int outer_loop = 100) {
     vector<double> times;
     times.reserve(outer_loop);
 
+    perf_begin();
     for (int i = 0; i < outer_loop; ++i) {
         auto start = std::chrono::high_resolution_clock::now();
         for (int j = 0; j < inner_loop; ++j) func();
@@ -18,6 +36,7 @@ pair<double, double> benchmark_stats(F func, int inner_loop = 1000, int outer_lo
         double total = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
         times.push_back(total / inner_loop);
     }
+    perf_end(uint64_t(inner_loop) * outer_loop);
 
     double sum = 0.0;
     for (double t : times) sum += t;
@@ -29,6 +48,25 @@ pair<double, double> benchmark_stats(F func, int inner_loop = 1000, int outer_lo
 
     return {mean, stddev};
 }
+// CPU time consumed by the calling thread, in nanoseconds.
+double thread_cpu_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+// Session key = SHA-256 of the canonical (compressed) encoding of a pairing value.
+// Returns false, with hash zeroed, if the encoding does not fit MAX_ELEMENT_LEN.
+bool hash_gt(const gt_t g, uint8_t hash[SHA256_DIGEST_LENGTH]) {
+    uint8_t buffer[MAX_ELEMENT_LEN];
+    int len = gt_size_bin(g, 1);
+    if (len > MAX_ELEMENT_LEN) {
+        memset(hash, 0, SHA256_DIGEST_LENGTH);
+        return false;
+    }
+    gt_write_bin(buffer, len, g, 1);
+    SHA256(buffer, len, hash);
+    return true;
+}
 void handle_error(const std::string& msg) {
     std::cerr << "[ERROR] " << msg << std::endl;
     exit(EXIT_FAILURE);
@@ -36,42 +74,131 @@ void handle_error(const std::string& msg) {
 void send_element(int sock, const g1_t& el) {
     uint8_t buffer[BUF_SIZE];
     int len = g1_size_bin(el, 1); // compressed
-    std::cout<<"g1 len:"<<len<<std::endl;
+    LOG_DEBUG("g1 len: {}", len);
     g1_write_bin(buffer, len, el, 1);
     send(sock, &len, sizeof(len), 0); 
     send(sock, buffer, len, 0);
+    metric_bytes_sent.inc(sizeof(len) + len);
 }
 
 void send_element(int sock, const g2_t& el) {
     uint8_t buffer[BUF_SIZE];
     int len = g2_size_bin(el, 1); // compressed
-    std::cout<<"g2 len:"<<len<<std::endl;
+    LOG_DEBUG("g2 len: {}", len);
     g2_write_bin(buffer, len, el, 1);
     send(sock, &len, sizeof(len), 0); 
     send(sock, buffer, len, 0);
+    metric_bytes_sent.inc(sizeof(len) + len);
 }
 void send_bn(int sock, const bn_t& n) {
     uint8_t buffer[BUF_SIZE];
     int len = bn_size_bin(n);
-    std::cout<<"bn len:"<<len<<std::endl;
+    LOG_DEBUG("bn len: {}", len);
     bn_write_bin(buffer, len, n);
     send(sock, &len, sizeof(len), 0); 
     send(sock, buffer, len, 0);
+    metric_bytes_sent.inc(sizeof(len) + len);
+}
+void put_u64(uint8_t* p, uint64_t v) {
+    for (int i = 7; i >= 0; --i, v >>= 8) p[i] = uint8_t(v);
+}
+uint64_t get_u64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v = v << 8 | p[i];
+    return v;
+}
+// An epoch travels as an 8-byte big-endian element.
+void send_u64(int sock, uint64_t v) {
+    uint8_t buffer[8];
+    int len = sizeof(buffer);
+    put_u64(buffer, v);
+    send(sock, &len, sizeof(len), 0);
+    send(sock, buffer, len, 0);
+    metric_bytes_sent.inc(sizeof(len) + len);
+}
+// Receives one length-prefixed element into buf. The peer-supplied length must be in (0, cap].
+bool recv_element(int sock, uint8_t* buf, int cap, int& len) {
+    if (recv(sock, &len, sizeof(len), MSG_WAITALL) != (ssize_t)sizeof(len)) return false;
+    if (len <= 0 || len > cap) return false;
+    return recv(sock, buf, len, MSG_WAITALL) == len;
+}
+bool recv_u64(int sock, uint64_t& v) {
+    uint8_t buffer[8];
+    int len;
+    if (!recv_element(sock, buffer, sizeof(buffer), len) || len != sizeof(buffer)) return false;
+    v = get_u64(buffer);
+    return true;
+}
+// Sends one datagram to every host on the local network on the given UDP port.
+// Returns the number of bytes sent, or -1.
+ssize_t udp_broadcast(const uint8_t* data, size_t len, int port) {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("UDP socket creation failed");
+        return -1;
+    }
+    int broadcastEnable = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &broadcastEnable, sizeof(broadcastEnable)) < 0) {
+        perror("setsockopt failed");
+        close(sock);
+        return -1;
+    }
+    sockaddr_in dest{};
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(port);
+    dest.sin_addr.s_addr = htonl(INADDR_BROADCAST);
+    ssize_t sent = sendto(sock, data, len, 0, (sockaddr*)&dest, sizeof(dest));
+    if (sent < 0) perror("Broadcast send failed");
+    else metric_bytes_sent.inc(sent);
+    close(sock);
+    return sent;
+}
+// Key update datagram: group ID (4) || epoch (8) || A (compressed G2) || x_r, integers
+// big endian. epoch is the epoch the update starts. Returns the length, or -1 if it
+// does not fit.
+int write_key_update(uint8_t* buffer, int cap, uint32_t group, uint64_t epoch, const g2_t& A, const bn_t& x_r) {
+    int len_A = g2_size_bin(A, 1);
+    int len_xr = bn_size_bin(x_r);
+    if (KEY_UPDATE_HEADER_LEN + len_A + len_xr > cap) return -1;
+    uint32_t id = htonl(group);
+    memcpy(buffer, &id, sizeof(id));
+    put_u64(buffer + sizeof(id), epoch);
+    g2_write_bin(buffer + KEY_UPDATE_HEADER_LEN, len_A, A, 1);
+    bn_write_bin(buffer + KEY_UPDATE_HEADER_LEN + len_A, len_xr, x_r);
+    return KEY_UPDATE_HEADER_LEN + len_A + len_xr;
+}
+// Reads the group ID and epoch of a key update datagram without parsing the rest.
+bool key_update_header(const uint8_t* buffer, int len, uint32_t& group, uint64_t& epoch) {
+    if (len < KEY_UPDATE_HEADER_LEN) return false;
+    uint32_t id;
+    memcpy(&id, buffer, sizeof(id));
+    group = ntohl(id);
+    epoch = get_u64(buffer + sizeof(id));
+    return true;
+}
+// Parses a key update datagram. len_g2 is the compressed G2 size of a valid member point.
+// The header is not checked here; receivers route on key_update_header first.
+bool read_key_update(const uint8_t* buffer, int len, int len_g2, g2_t A, bn_t x_r) {
+    len -= KEY_UPDATE_HEADER_LEN;
+    if (len <= len_g2 || len - len_g2 > MAX_SCALAR_LEN) return false;
+    g2_read_bin(A, buffer + KEY_UPDATE_HEADER_LEN, len_g2);
+    bn_read_bin(x_r, buffer + KEY_UPDATE_HEADER_LEN + len_g2, len - len_g2);
+    return true;
 }
-std::vector<uint8_t> serialize_element(g1_t elem) {
+std::vector<uint8_t> serialize_element(const g1_t elem) {
     int len = g1_size_bin(elem, 1);
     std::vector<uint8_t> buf(len);
     g1_write_bin(buf.data(), len, elem, 1);
     return buf;
 }
-std::vector<uint8_t> serialize_element(g2_t elem) {
+std::vector<uint8_t> serialize_element(const g2_t elem) {
     int len = g2_size_bin(elem, 1);
     std::vector<uint8_t> buf(len);
     g2_write_bin(buf.data(), len, elem, 1);
     return buf;
 }
 
-std::vector<uint8_t> serialize_element(bn_t elem) {
+std::vector<uint8_t> serialize_element(const bn_t elem) {
     int len = bn_size_bin(elem);
     std::vector<uint8_t> buf(len);
     bn_write_bin(buf.data(), len, elem);
@@ -9,33 +9,114 @@
 #include<utility>
 #include <cmath>
 #include <numeric>
+#include <poll.h>
+#include <deque>
+#include <memory>
+#include <unordered_map>
 #include"utils.cpp"
+#include"deterministic.cpp"
+#include"auth.cpp"
+#include"lazy.cpp"
+#include"persist.cpp"
 using namespace std;
 #define TA_IP "127.0.0.1"
 #define TA_PORT 9876
 #define TA_ACK_PORT 9998
 #define BROADCAST_PORT 9999
 #define BUF_SIZE 4096
+#define METRICS_PORT 9101
+#define TRACE_FILE "vehicle-trace.json"
+#define VEHICLE_ID "veh_id_123456"
+#define AUTH_BENCH_ROUNDS 100
+#define LAZY_BENCH_UPDATES 64
+#define MULTI_BENCH_GROUPS 64
+#define MULTI_BENCH_UPDATES 256
+#define MULTI_BENCH_ROUTE_ROUNDS 1000
+#define COLDSTART_ROUNDS 100
+#include"ecu.cpp"
+
+Counter metric_key_updates("sgkd_key_updates_total", "Key updates applied by this vehicle.");
+Histogram metric_update_latency("sgkd_update_seconds", "Vehicle-side UpdateMemberSecrets latency.");
+Counter metric_foreign_updates("sgkd_foreign_updates_total", "Key updates dropped because this vehicle is not in their group.");
+Counter metric_missed_updates("sgkd_missed_updates_total", "Epochs skipped between two key updates of a group.");
+
+std::string auth_dir; // set by --auth; enables the authenticated handshake
+AuthIdentity vehicle_auth;
+bool lazy_updates = false; // set by --lazy; fold key updates and derive the key on demand
+std::string state_path;     // set by --state; persist credentials for instant cold start
+double relic_init_ns = 0;   // core_init and pc_param_set_any at startup
+static LazyMember lazy_member;
+
+// One group credential. A vehicle can belong to several groups at once; each group has
+// its own TA, its own (x_i, w1, w2) and, with --lazy, its own pending updates. Key
+// updates carry the group ID in their header and are routed through the groups map.
+struct GroupMember {
+    uint32_t id = DEFAULT_GROUP;
+    int port = TA_PORT; // registration port of the group's TA
+    uint64_t epoch = 0;     // latest update applied or folded
+    uint64_t key_epoch = 0; // epoch of w2 and key; behind epoch while lazy updates are pending
+    bn_t x_i;
+    g1_t w1;
+    g2_t w2;
+    uint8_t key[SHA256_DIGEST_LENGTH];
+    bool revoked = false;   // an update revoked this vehicle; no key until it registers again
+    uint8_t fingerprint[FINGERPRINT_LEN]; // TA group instance, from the first catch-up
+    bool fingerprint_known = false;
+    std::unique_ptr<LazyMember> lazy;
+};
+std::unordered_map<uint32_t, GroupMember> groups;
+// Lazy groups with pending updates, oldest first. An entry is stale once its group has
+// been materialised since; stale entries are skipped when they reach the front.
+std::deque<std::pair<uint32_t, std::chrono::steady_clock::time_point>> lazy_deadlines;
+
+GroupMember& add_group(uint32_t id, int port) {
+    GroupMember& g = groups[id];
+    g.id = id;
+    g.port = port;
+    bn_null(g.x_i); g1_null(g.w1); g2_null(g.w2);
+    bn_new(g.x_i); g1_new(g.w1); g2_new(g.w2);
+    if (lazy_updates) {
+        g.lazy.reset(new LazyMember);
+        lazy_alloc(*g.lazy);
+    }
+    return g;
+}
+
+void free_groups() {
+    for (auto& [id, g] : groups) {
+        bn_free(g.x_i); g1_free(g.w1); g2_free(g.w2);
+        if (g.lazy) lazy_free(*g.lazy);
+    }
+    groups.clear();
+    lazy_deadlines.clear();
+}
 
 //compile it using: g++ vehicle.cpp -o vehicle   -I/usr/local/relic/include   -L/usr/local/relic/lib -lrelic_s   -lssl -lcrypto   -std=c++17
-void derive_key(g1_t w1, g2_t w2) {
+void derive_key(g1_t w1, g2_t w2, uint8_t* key_out = nullptr) {
     gt_t pairing_result;
     gt_null(pairing_result); gt_new(pairing_result);
     pc_map(pairing_result, w1, w2);
 
-    uint8_t buffer[512];
-    int len = gt_size_bin(pairing_result, 1);
-    gt_write_bin(buffer, len, pairing_result, 1);
-
     uint8_t hash[SHA256_DIGEST_LENGTH];
-    SHA256(buffer, len, hash);
+    bool derived = hash_gt(pairing_result, hash);
+    gt_free(pairing_result);
+    if (key_out) memcpy(key_out, hash, SHA256_DIGEST_LENGTH);
+    if (!derived) {
+        LOG_ERROR("Could not hash the pairing value; no session key derived");
+        return;
+    }
+    transcript_note("vehicle.session_key", hash, SHA256_DIGEST_LENGTH);
 
-    std::cout << "[*] Session Key: ";
+    char hex[2 * SHA256_DIGEST_LENGTH + 1];
     for (int i = 0; i < SHA256_DIGEST_LENGTH; i++)
-        printf("%02x", hash[i]);
-    std::cout << std::endl;
+        snprintf(hex + 2 * i, 3, "%02x", hash[i]);
+    LOG_INFO("Session Key: {}", hex);
 }
-void UpdateMemberSecrets(const g1_t& w1, g2_t& w2, const bn_t& x_i, const g2_t& A_new, const bn_t& x_r) {
+void UpdateMemberSecrets(const g1_t& w1, g2_t& w2, const bn_t& x_i, const g2_t& A_new, const bn_t& x_r,
+                         uint8_t* key_out = nullptr) {
+    HistogramTimer timer(metric_update_latency);
+    TraceSpan total("UpdateMemberSecrets");
+    TraceSpan span("UpdateMemberSecrets.inv");
     bn_t ord, exp;
     bn_new(ord); bn_new(exp);
     ep_curve_get_ord(ord);
@@ -44,90 +125,191 @@ void UpdateMemberSecrets(const g1_t& w1, g2_t& w2, const bn_t& x_i, const g2_t&
     bn_sub(exp, x_i, x_r);
     bn_mod_inv(exp, exp, ord);
 
-    g2_t w2_old_exp, A_exp, w2_new;
-    g2_new(w2_old_exp); g2_new(A_exp); g2_new(w2_new);
-
-    // w2_old_exp = w2^e
-    g2_mul(w2_old_exp, w2, exp);
-    // A_exp = A^e
-    g2_mul(A_exp, A_new, exp);
-
-    // w2_new = A^e / w2^e
-    g2_neg(w2_old_exp, w2_old_exp);         // Point negation
-    g2_add(w2_new, A_exp, w2_old_exp);      // Group addition (A_exp * w2_old_exp^{-1})
-
-    // Update stored w2
-    g2_copy(w2, w2_new);
+    // w2 = A^e / w2^e (update_kernel.cpp)
+    span.next("UpdateMemberSecrets.g2");
+    static g2_t scratch;
+    static bool scratch_ready = false;
+    if (!scratch_ready) {
+        g2_null(scratch);
+        g2_new(scratch);
+        scratch_ready = true;
+    }
+    g2_update_w2(w2, A_new, exp, scratch);
 
     // Derive new key
+    span.next("UpdateMemberSecrets.pairing");
     gt_t shared;
     gt_new(shared);
     pc_map(shared, w1, w2);
+    span.next("UpdateMemberSecrets.hash");
     uint8_t hash[SHA256_DIGEST_LENGTH];
-    SHA256((uint8_t*)shared, sizeof(shared), hash);
-
-    std::cout << "[INFO] New session key derived (SHA256 hash of pairing result)" << std::endl;
+    bool derived = hash_gt(shared, hash);
+    if (key_out) memcpy(key_out, hash, SHA256_DIGEST_LENGTH);
+    transcript_note("update.w2", w2);
+    if (derived) {
+        transcript_note("update.session_key", hash, SHA256_DIGEST_LENGTH);
+        metric_key_updates.inc();
+        LOG_INFO("New session key derived (SHA256 hash of pairing result)");
+    } else {
+        LOG_ERROR("Could not hash the pairing value; the session key is cleared");
+    }
 
     // Cleanup
     bn_free(ord); bn_free(exp);
-    g2_free(w2_old_exp); g2_free(A_exp); g2_free(w2_new);
     gt_free(shared);
 }
 
-void listen_for_key_update(const g1_t& w1, g2_t& w2, const bn_t& x_i) {
-    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sockfd < 0) {
-        perror("UDP socket creation failed");
-        return;
-    }
-
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(BROADCAST_PORT);
-    addr.sin_addr.s_addr = INADDR_ANY;
-
-    if (bind(sockfd, (sockaddr*)&addr, sizeof(addr)) < 0) {
-        perror("UDP bind failed");
-        close(sockfd);
-        return;
-    }
-
-    std::cout << "[INFO] Listening for key updates on UDP port " << BROADCAST_PORT << std::endl;
-
-    uint8_t buffer[BUF_SIZE];
-
-    while (true) {
-        ssize_t len = recv(sockfd, buffer, BUF_SIZE, 0);
-        if (len <= 0) continue;
-
-        int offset = 0;
+// Outcome of a catch-up. Only a void credential calls for registering again; an
+// unreachable TA is retried at the next gap in the epochs.
+enum CatchUp { CAUGHT_UP, CATCHUP_UNREACHABLE, CATCHUP_VOID };
 
-        g2_t A_recv;
-        bn_t x_r;
-        g2_new(A_recv);
-        bn_new(x_r);
+CatchUp catch_up(GroupMember& g);
+bool register_group(GroupMember& g);
 
-        int len_g2 = g2_size_bin(A_recv, 1);
-        g2_read_bin(A_recv, buffer + offset, len_g2);
-        offset += len_g2;
+// An update with x_r == x_i revokes this vehicle from the group. Its credential cannot
+// follow any later update, so the key is wiped and further updates are ignored.
+void mark_revoked(GroupMember& g, uint64_t epoch) {
+    g.revoked = true;
+    g.epoch = epoch;
+    memset(g.key, 0, SHA256_DIGEST_LENGTH);
+    LOG_ERROR("This vehicle was revoked from group {} at epoch {}; its group key is no longer valid", g.id, epoch);
+}
 
-        int len_xr = len - offset;
-        bn_read_bin(x_r, buffer + offset, len_xr);
+// Routes one key update datagram to its group and applies or folds it. Returns the
+// group, or nullptr if the datagram is malformed, already applied or for a group this
+// vehicle is not in or was revoked from. A gap in the epochs means updates were lost:
+// the group catches up from its TA, or registers again if the TA no longer has them.
+// If the TA is unreachable the update is dropped, and the next one retries.
+GroupMember* dispatch_key_update(const uint8_t* datagram, int len) {
+    uint32_t id;
+    uint64_t epoch;
+    auto it = groups.end();
+    if (key_update_header(datagram, len, id, epoch)) it = groups.find(id);
+    if (it == groups.end()) {
+        metric_foreign_updates.inc();
+        LOG_DEBUG("Dropped key update for a foreign group ({} bytes)", len);
+        return nullptr;
+    }
+    GroupMember& g = it->second;
+    if (g.revoked) {
+        LOG_DEBUG("Ignored key update for group {}, which revoked this vehicle", id);
+        return nullptr;
+    }
+    if (epoch <= g.epoch) {
+        LOG_DEBUG("Ignored key update for epoch {} of group {} (credential is at epoch {})", epoch, id, g.epoch);
+        return nullptr;
+    }
+    if (epoch > g.epoch + 1) {
+        metric_missed_updates.inc(epoch - g.epoch - 1);
+        LOG_WARN("Group {} missed {} key update(s) before epoch {}", id, epoch - g.epoch - 1, epoch);
+        CatchUp caught = catch_up(g);
+        if (caught == CATCHUP_UNREACHABLE) return nullptr;
+        if (caught == CATCHUP_VOID && !register_group(g)) return nullptr;
+        if (epoch <= g.epoch) return &g;
+        if (epoch > g.epoch + 1) return nullptr;
+    }
+    if (g.lazy) {
+        LazyFold folded = lazy_fold(*g.lazy, datagram, len);
+        if (folded == LAZY_REVOKED) {
+            mark_revoked(g, epoch);
+            return nullptr;
+        }
+        if (folded == LAZY_MALFORMED) {
+            LOG_WARN("Dropped malformed key update for group {} ({} bytes)", id, len);
+            return nullptr;
+        }
+        g.epoch = epoch;
+        if (g.lazy->pending == 1) lazy_deadlines.push_back({id, g.lazy->first_pending});
+        LOG_DEBUG("Key update folded into group {} ({} pending)", id, g.lazy->pending);
+        return &g;
+    }
 
-        std::cout << "[INFO] Key update received: updating member secrets..." << std::endl;
-        UpdateMemberSecrets(w1, w2, x_i, A_recv, x_r);
+    g2_t A_recv;
+    bn_t x_r;
+    g2_new(A_recv);
+    bn_new(x_r);
+    bool ok = read_key_update(datagram, len, g2_size_bin(g.w2, 1), A_recv, x_r);
+    if (ok && bn_cmp(x_r, g.x_i) == RLC_EQ) {
+        mark_revoked(g, epoch);
+        ok = false;
+    } else if (ok) {
+        LOG_DEBUG("Key update received for group {}: updating member secrets...", id);
+        UpdateMemberSecrets(g.w1, g.w2, g.x_i, A_recv, x_r, g.key);
+        g.epoch = g.key_epoch = epoch;
+    } else {
+        LOG_WARN("Dropped malformed key update for group {} ({} bytes)", id, len);
+    }
+    g2_free(A_recv);
+    bn_free(x_r);
+    return ok ? &g : nullptr;
+}
 
-        g2_free(A_recv); bn_free(x_r);
+void save_state();
+
+// Materialises every lazy group whose oldest pending update has reached its deadline.
+// Returns the poll timeout until the next deadline, or -1 if nothing is pending.
+int materialize_due_groups() {
+    bool materialized = false;
+    int timeout = -1;
+    while (!lazy_deadlines.empty()) {
+        auto [id, since] = lazy_deadlines.front();
+        auto it = groups.find(id);
+        if (it == groups.end() || it->second.lazy->pending == 0 || it->second.lazy->first_pending != since) {
+            lazy_deadlines.pop_front();
+            continue;
+        }
+        GroupMember& g = it->second;
+        int wait = lazy_wait_ms(*g.lazy);
+        if (wait > 0) {
+            timeout = wait;
+            break;
+        }
+        lazy_deadlines.pop_front();
+
+        HistogramTimer timer(metric_update_latency);
+        int folded = g.lazy->pending;
+        if (!lazy_group_key(*g.lazy)) LOG_ERROR("Could not hash the group key of group {}", g.id);
+        g2_copy(g.w2, g.lazy->w2);
+        memcpy(g.key, g.lazy->key, SHA256_DIGEST_LENGTH);
+        g.key_epoch = g.epoch;
+        materialized = true;
+        metric_key_updates.inc(folded);
+        transcript_note("update.w2", g.w2);
+        transcript_note("update.session_key", g.lazy->key, SHA256_DIGEST_LENGTH);
+        LOG_INFO("New session key for group {} derived from {} folded updates", id, folded);
     }
+    if (materialized) save_state();
+    return timeout;
+}
 
-    close(sockfd);
+// ACK to the TA after an applied update. This is not part of the SGKD protocol; it is
+// only used for the end-to-end latency measurement.
+// port is the registration port of the group's TA; its ACK port moves with it.
+void send_ack(const std::string& vehicle_id, int port) {
+    int ack_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (ack_sock < 0) {
+        perror("ACK socket creation failed");
+        return;
+    }
+    sockaddr_in ta_addr{};
+    ta_addr.sin_family = AF_INET;
+    ta_addr.sin_port = htons(TA_ACK_PORT + port - TA_PORT);
+    ta_addr.sin_addr.s_addr = inet_addr(TA_IP);
+    sendto(ack_sock, vehicle_id.c_str(), vehicle_id.length(), 0, (sockaddr*)&ta_addr, sizeof(ta_addr));
+    LOG_DEBUG("Sent ACK to TA: {}", vehicle_id);
+    close(ack_sock);
 }
-//The listen_for_key_update_benchmark function used in measuring the end-to-end latency of vehicle revocation/key update process
-void listen_for_key_update_benchmark(const g1_t& w1, g2_t& w2, const bn_t& x_i, const std::string& vehicle_id) {
+
+// Serves the key updates of every group from one UDP socket and one poll loop. Eager
+// groups apply an update on arrival and ACK it; lazy groups fold it and materialise
+// at their deadline (see lazy.cpp).
+// Binds the key update socket. It is opened before registering, so every update
+// broadcast after the TA issued a credential is queued until the listener runs.
+int open_update_socket() {
     int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     if (sockfd < 0) {
         perror("UDP socket creation failed");
-        return;
+        return -1;
     }
 
     sockaddr_in addr{};
@@ -138,60 +320,301 @@ void listen_for_key_update_benchmark(const g1_t& w1, g2_t& w2, const bn_t& x_i,
     if (bind(sockfd, (sockaddr*)&addr, sizeof(addr)) < 0) {
         perror("UDP bind failed");
         close(sockfd);
-        return;
+        return -1;
     }
-
-    std::cout << "[INFO] Listening for key updates on UDP port " << BROADCAST_PORT << std::endl;
+    return sockfd;
+}
+void listen_for_key_updates(const std::string& vehicle_id, int sockfd) {
+    LOG_INFO("Listening for key updates of {} group(s) on UDP port {}{}", groups.size(), BROADCAST_PORT,
+             lazy_updates ? " (lazy)" : "");
 
     uint8_t buffer[BUF_SIZE];
 
     while (true) {
+        pollfd pfd{sockfd, POLLIN, 0};
+        if (poll(&pfd, 1, materialize_due_groups()) <= 0) continue;
         ssize_t len = recv(sockfd, buffer, BUF_SIZE, 0);
         if (len <= 0) continue;
+        GroupMember* g = dispatch_key_update(buffer, len);
+        if (g && !g->lazy) {
+            // ACK first: the state file flush must not count towards the TA's update latency.
+            send_ack(vehicle_id, g->port);
+            save_state();
+        }
+    }
 
-        int offset = 0;
-
-        g2_t A_recv;
-        bn_t x_r;
-        g2_new(A_recv);
-        bn_new(x_r);
-
-        int len_g2 = g2_size_bin(A_recv, 1);
-        g2_read_bin(A_recv, buffer + offset, len_g2);
-        offset += len_g2;
-
-        int len_xr = len - offset;
-        bn_read_bin(x_r, buffer + offset, len_xr);
-
-        std::cout << "[INFO] Key update received: updating member secrets..." << std::endl;
-        UpdateMemberSecrets(w1, w2, x_i, A_recv, x_r);
-
-        // Send ACK back to TA
-        // This is not part of the SGKP protocol. We add it here for the end-to-end latency measurment
-        int ack_sock = socket(AF_INET, SOCK_DGRAM, 0);
-        if (ack_sock >= 0) {
-            sockaddr_in ta_addr{};
-            ta_addr.sin_family = AF_INET;
-            ta_addr.sin_port = htons(TA_ACK_PORT);
-            ta_addr.sin_addr.s_addr = inet_addr(TA_IP);
-
-            sendto(ack_sock, vehicle_id.c_str(), vehicle_id.length(), 0,
-                   (sockaddr*)&ta_addr, sizeof(ta_addr));
+    close(sockfd);
+}
+int connect_ta(int port = TA_PORT) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+    sockaddr_in serv_addr{};
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(port);
+    inet_pton(AF_INET, TA_IP, &serv_addr.sin_addr);
+    if (connect(sock, (sockaddr*)&serv_addr, sizeof(serv_addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+// Writes every group's credential, key epoch and key to the state file (persist.cpp).
+// Group record: id (4) | epoch (8) | fingerprint | key | x_i | w1 | w2, points
+// uncompressed so that loading skips point decompression. Lazy groups are saved as of
+// their last materialisation; their pending updates are fetched again by catch-up.
+void save_state() {
+    if (state_path.empty()) return;
+    TraceSpan span("SaveState");
+    StateWriter w;
+    uint8_t buffer[MAX_ELEMENT_LEN];
+    for (auto& [id, g] : groups) {
+        w.u32(id);
+        w.u64(g.key_epoch);
+        w.bytes(g.fingerprint, FINGERPRINT_LEN);
+        w.bytes(g.key, SHA256_DIGEST_LENGTH);
+        int len = bn_size_bin(g.x_i);
+        bn_write_bin(buffer, len, g.x_i);
+        w.bytes(buffer, len);
+        len = g1_size_bin(g.w1, 0);
+        g1_write_bin(buffer, len, g.w1, 0);
+        w.bytes(buffer, len);
+        len = g2_size_bin(g.w2, 0);
+        g2_write_bin(buffer, len, g.w2, 0);
+        w.bytes(buffer, len);
+        w.records++;
+    }
+    if (!state_save(state_path, w)) LOG_WARN("Could not write the state file {}", state_path);
+}
+// Restores every configured group from the state file without contacting a TA.
+// Returns false if there is no usable state or it does not hold exactly the
+// configured groups; nothing is restored then.
+bool load_state() {
+    if (state_path.empty()) return false;
+    TraceSpan span("LoadState");
+    StateFile file;
+    if (!file.open(state_path)) return false;
+    if (file.records != groups.size()) {
+        LOG_WARN("State file {} holds {} group(s), {} configured", state_path, file.records, groups.size());
+        return false;
+    }
+    g1_t p1;
+    g2_t p2;
+    g1_new(p1); g2_new(p2);
+    g1_get_gen(p1);
+    g2_get_gen(p2);
+    uint32_t len_g1 = g1_size_bin(p1, 0), len_g2 = g2_size_bin(p2, 0);
+    g1_free(p1); g2_free(p2);
+
+    struct Record { GroupMember* g; uint64_t epoch; const uint8_t *fp, *key, *x_i, *w1, *w2; uint32_t len_x; };
+    std::vector<Record> records;
+    StateReader r = file.body();
+    for (uint32_t i = 0; i < file.records; ++i) {
+        Record rec;
+        uint32_t id = r.u32(), len_fp, len_key, len_w1, len_w2;
+        rec.epoch = r.u64();
+        rec.fp = r.bytes(len_fp);
+        rec.key = r.bytes(len_key);
+        rec.x_i = r.bytes(rec.len_x);
+        rec.w1 = r.bytes(len_w1);
+        rec.w2 = r.bytes(len_w2);
+        auto it = groups.find(id);
+        if (!r.ok || it == groups.end() || len_fp != FINGERPRINT_LEN || len_key != SHA256_DIGEST_LENGTH || rec.len_x == 0 ||
+            rec.len_x > MAX_SCALAR_LEN || len_w1 != len_g1 || len_w2 != len_g2) {
+            LOG_WARN("State file {} does not match the configured groups or this curve", state_path);
+            return false;
+        }
+        rec.g = &it->second;
+        records.push_back(rec);
+    }
+    for (const Record& rec : records) {
+        GroupMember& g = *rec.g;
+        bn_read_bin(g.x_i, rec.x_i, rec.len_x);
+        g1_read_bin(g.w1, rec.w1, len_g1);
+        g2_read_bin(g.w2, rec.w2, len_g2);
+        g.epoch = g.key_epoch = rec.epoch;
+        memcpy(g.fingerprint, rec.fp, FINGERPRINT_LEN);
+        g.fingerprint_known = true;
+        memcpy(g.key, rec.key, SHA256_DIGEST_LENGTH);
+        if (g.lazy) {
+            lazy_init(*g.lazy, g.x_i, g.w1, g.w2);
+            memcpy(g.lazy->key, g.key, SHA256_DIGEST_LENGTH);
+            g.lazy->key_valid = true;
+        }
+    }
+    return true;
+}
+// Fetches and applies the key updates the group missed since its epoch. Returns false
+// if the TA is unreachable, no longer has them, or now runs another group instance
+// (its fingerprint changed, e.g. after a new Setup); the group must register again then.
+// The first catch-up after registering learns the fingerprint.
+CatchUp catch_up(GroupMember& g) {
+    TraceSpan span("CatchUp");
+    int sock = connect_ta(g.port);
+    if (sock < 0) {
+        LOG_WARN("Catch-up of group {} from epoch {} failed: TA unreachable", g.id, g.epoch);
+        return CATCHUP_UNREACHABLE;
+    }
+    uint8_t request[1 + 8] = {CATCHUP_REQUEST};
+    put_u64(request + 1, g.epoch);
+    uint64_t count = 0;
+    uint8_t datagram[BUF_SIZE];
+    int len;
+    bool ok = send(sock, request, sizeof(request), MSG_NOSIGNAL) == (ssize_t)sizeof(request) &&
+              recv_element(sock, datagram, sizeof(datagram), len) && len == FINGERPRINT_LEN;
+    if (ok && g.fingerprint_known && memcmp(g.fingerprint, datagram, FINGERPRINT_LEN) != 0) {
+        LOG_WARN("The TA of group {} runs another group instance; the credential is void", g.id);
+        close(sock);
+        return CATCHUP_VOID;
+    }
+    if (ok && !g.fingerprint_known) {
+        memcpy(g.fingerprint, datagram, FINGERPRINT_LEN);
+        g.fingerprint_known = true;
+    }
+    ok = ok && recv_u64(sock, count);
+    if (ok && count == CATCHUP_GONE) {
+        LOG_WARN("The TA of group {} no longer has the updates after epoch {}", g.id, g.epoch);
+        close(sock);
+        return CATCHUP_VOID;
+    }
+    for (uint64_t i = 0; ok && !g.revoked && i < count; ++i) {
+        uint32_t id;
+        uint64_t epoch;
+        ok = recv_element(sock, datagram, sizeof(datagram), len) && key_update_header(datagram, len, id, epoch) &&
+             id == g.id && epoch == g.epoch + 1 && (dispatch_key_update(datagram, len) == &g || g.revoked);
+    }
+    close(sock);
+    if (!ok) {
+        LOG_WARN("Catch-up of group {} from epoch {} failed", g.id, g.epoch);
+        return CATCHUP_UNREACHABLE;
+    }
+    if (count > 0) LOG_INFO("Group {} caught up on {} missed update(s), now at epoch {}", g.id, count, g.epoch);
+    return CAUGHT_UP;
+}
+// Authenticated registration (see auth.cpp). Resumes from the stored ticket when there
+// is one and falls back to a full handshake if the TA does not accept it. Every group
+// other than the default keeps its own ticket, since each group's TA seals its own.
+bool authenticated_register(bn_t x_i, g1_t w1, g2_t w2, uint64_t& epoch, bool allow_resume = true,
+                            uint32_t group = DEFAULT_GROUP, int port = TA_PORT) {
+    TraceSpan span("AuthRegister");
+    std::string ticket_path = auth_dir + "/" + VEHICLE_ID +
+                              (group == DEFAULT_GROUP ? "" : "." + std::to_string(group)) + ".ticket";
+    AuthTicket ticket, next;
+    Bytes plaintext;
+    bool ok = false;
+    if (allow_resume && ticket.load(ticket_path)) {
+        int sock = connect_ta(port);
+        ok = sock >= 0 && auth_client_resume(sock, ticket, plaintext, next);
+        if (sock >= 0) close(sock);
+        if (!ok) LOG_WARN("Ticket rejected by the TA, falling back to a full handshake");
+    }
+    if (!ok) {
+        int sock = connect_ta(port);
+        ok = sock >= 0 && auth_client_full(sock, vehicle_auth, plaintext, next);
+        if (sock >= 0) close(sock);
+    }
+    std::vector<Bytes> fields;
+    if (!ok || !auth_client_finish(plaintext, fields, next) || fields.size() != 4 || fields[3].size() != 8 ||
+        fields[0].empty() || fields[0].size() > MAX_SCALAR_LEN || fields[1].empty() ||
+        fields[1].size() > MAX_ELEMENT_LEN || fields[2].empty() || fields[2].size() > MAX_ELEMENT_LEN)
+        return false;
+    bn_read_bin(x_i, fields[0].data(), fields[0].size());
+    g1_read_bin(w1, fields[1].data(), fields[1].size());
+    g2_read_bin(w2, fields[2].data(), fields[2].size());
+    epoch = get_u64(fields[3].data());
+    if (!next.save(ticket_path)) LOG_WARN("Could not store the session ticket in {}", ticket_path);
+    transcript_note("vehicle.xi", x_i);
+    transcript_note("vehicle.w1", w1);
+    transcript_note("vehicle.w2", w2);
+    return true;
+}
+// Registers with the TA of one group and derives the group's first key.
+bool register_group(GroupMember& g)
+{
+    if (!auth_dir.empty()) {
+        if (!authenticated_register(g.x_i, g.w1, g.w2, g.key_epoch, true, g.id, g.port)) {
+            LOG_ERROR("Authenticated registration with group {} failed", g.id);
+            return false;
+        }
+    } else {
+        int sock = connect_ta(g.port);
+        if (sock < 0) {
+            perror("connect failed");
+            return false;
+        }
 
-            std::cout << "[INFO] Sent ACK to TA: " << vehicle_id << std::endl;
+        const char* id = "veh_id_123456";
+        send(sock, id, 16, 0);
 
-            close(ack_sock);
-        } else {
-            perror("ACK socket creation failed");
+        int len;
+        uint8_t buffer[MAX_ELEMENT_LEN];
+        if (!recv_element(sock, buffer, MAX_SCALAR_LEN, len)) {
+            LOG_ERROR("Registration failed: bad x_i from TA");
+            close(sock);
+            return false;
         }
-
-        g2_free(A_recv); 
-        bn_free(x_r);
+        bn_read_bin(g.x_i, buffer, len);
+        if (!recv_element(sock, buffer, MAX_ELEMENT_LEN, len)) {
+            LOG_ERROR("Registration failed: bad w1 from TA");
+            close(sock);
+            return false;
+        }
+        g1_read_bin(g.w1, buffer, len);
+        if (!recv_element(sock, buffer, MAX_ELEMENT_LEN, len)) {
+            LOG_ERROR("Registration failed: bad w2 from TA");
+            close(sock);
+            return false;
+        }
+        g2_read_bin(g.w2, buffer, len);
+        if (!recv_u64(sock, g.key_epoch)) {
+            LOG_ERROR("Registration failed: bad epoch from TA");
+            close(sock);
+            return false;
+        }
+        transcript_note("vehicle.xi", g.x_i);
+        transcript_note("vehicle.w1", g.w1);
+        transcript_note("vehicle.w2", g.w2);
+        close(sock);
     }
-
-    close(sockfd);
+    g.epoch = g.key_epoch;
+    g.revoked = false;
+    g.fingerprint_known = false;
+    if (g.lazy) lazy_init(*g.lazy, g.x_i, g.w1, g.w2);
+    derive_key(g.w1, g.w2, g.key);
+    // With --workers the TA may have issued the credential under an epoch it revoked
+    // while replying, and broadcast that update before this vehicle was listening.
+    return catch_up(g) == CAUGHT_UP;
 }
+// With --state, the vehicle resumes from the state file and only asks each TA for
+// the updates it missed; without a usable file it registers and writes one. A TA that
+// is unreachable at start does not stop the vehicle: it listens on the saved
+// credential and catches up at the first gap in the epochs.
 void registervehicle()
+{
+    int sockfd = open_update_socket();
+    if (sockfd < 0) return;
+    if (load_state()) {
+        LOG_INFO("Resumed {} group(s) from {} without registering", groups.size(), state_path);
+        for (auto& [id, g] : groups) {
+            CatchUp caught = catch_up(g);
+            if (caught == CATCHUP_UNREACHABLE)
+                LOG_WARN("Listening on the saved credential of group {}; catch-up is retried at the next gap", id);
+            if (caught == CATCHUP_VOID && !register_group(g)) {
+                close(sockfd);
+                return;
+            }
+        }
+    } else {
+        for (auto& [id, g] : groups)
+            if (!register_group(g)) {
+                close(sockfd);
+                return;
+            }
+    }
+    save_state();
+    listen_for_key_updates(VEHICLE_ID, sockfd);
+}
+//The registrvehicle_benchmark function is used for measuring the end-to-end latency of the vehicle registration process.
+void registervehicle_benchmark()
 {
     bn_t x_i;
     g1_t w1;
@@ -203,6 +626,16 @@ void registervehicle()
     ep_curve_get_ord(ord);
     bn_rand_mod(x_i,ord);
 
+    uint64_t epoch;
+    if (!auth_dir.empty()) {
+        if (!authenticated_register(x_i, w1, w2, epoch)) {
+            LOG_ERROR("Authenticated registration failed");
+            return;
+        }
+        derive_key(w1, w2);
+        return;
+    }
+
     int sock = socket(AF_INET, SOCK_STREAM, 0);
     if (sock < 0) {
         perror("socket failed");
@@ -222,97 +655,263 @@ void registervehicle()
     const char* id = "veh_id_123456";
     send(sock, id, 16, 0);
 
-    uint8_t buf[2048];
-
-    int offset = 0;
-    int len_xi = bn_size_bin(x_i);
-    int len_g1 = g1_size_bin(w1, 1);
-    int len_g2 = g2_size_bin(w2,1);
-
     int len;
-    recv(sock, &len, sizeof(len), MSG_WAITALL);  // Receive length
-    uint8_t buffer[1024];
-    recv(sock, buffer, len, MSG_WAITALL);        // Receive data
+    uint8_t buffer[MAX_ELEMENT_LEN];
+    if (!recv_element(sock, buffer, MAX_SCALAR_LEN, len)) {
+        LOG_ERROR("Registration failed: bad x_i from TA");
+        close(sock);
+        return;
+    }
     bn_read_bin(x_i, buffer, len);
-    recv(sock, &len, sizeof(len), MSG_WAITALL);  // Receive length
-    recv(sock, buffer, len, MSG_WAITALL);        // Receive data
+    if (!recv_element(sock, buffer, MAX_ELEMENT_LEN, len)) {
+        LOG_ERROR("Registration failed: bad w1 from TA");
+        close(sock);
+        return;
+    }
     g1_read_bin(w1, buffer, len);
-    
-    recv(sock, &len, sizeof(len), MSG_WAITALL);  // Receive length
-    recv(sock, buffer, len, MSG_WAITALL);        // Receive data
+    if (!recv_element(sock, buffer, MAX_ELEMENT_LEN, len)) {
+        LOG_ERROR("Registration failed: bad w2 from TA");
+        close(sock);
+        return;
+    }
     g2_read_bin(w2, buffer, len);
+    if (!recv_u64(sock, epoch)) {
+        LOG_ERROR("Registration failed: bad epoch from TA");
+        close(sock);
+        return;
+    }
+    transcript_note("vehicle.xi", x_i);
+    transcript_note("vehicle.w1", w1);
+    transcript_note("vehicle.w2", w2);
 
     derive_key(w1, w2);
     close(sock);
-    listen_for_key_update_benchmark(w1,w2,x_i,id);
 
 }
-//The registrvehicle_benchmark function is used for measuring the end-to-end latency of the vehicle registration process.
-void registervehicle_benchmark()
+// Compares the full (certificate) handshake with the resumed (ticket) one, end to end.
+// TA-side CPU per join is exported as sgkd_handshake_{full,resumed}_cpu_seconds.
+void handshake_benchmark()
 {
+    if (auth_dir.empty()) {
+        std::cerr << "The handshake benchmark needs --auth DIR." << std::endl;
+        return;
+    }
     bn_t x_i;
     g1_t w1;
     g2_t w2;
     bn_null(x_i); g1_null(w1); g2_null(w2);
     bn_new(x_i); g1_new(w1); g2_new(w2);
-    bn_t ord;
-    bn_new(ord);
-    ep_curve_get_ord(ord);
-    bn_rand_mod(x_i,ord);
+    int failures = 0;
+    uint64_t epoch;
+    auto [full_avg, full_std] = benchmark_stats([&] { failures += !authenticated_register(x_i, w1, w2, epoch, false); }, 1, AUTH_BENCH_ROUNDS);
+    cout << "Full Handshake Latency:   " << full_avg << " ns (±" << full_std << ")\n";
+    perf_report("handshake_full", full_avg, full_std);
+    auto [resumed_avg, resumed_std] = benchmark_stats([&] { failures += !authenticated_register(x_i, w1, w2, epoch, true); }, 1, AUTH_BENCH_ROUNDS);
+    cout << "Resumed Handshake Latency:" << resumed_avg << " ns (±" << resumed_std << ")\n";
+    perf_report("handshake_resumed", resumed_avg, resumed_std);
+    if (failures) cout << failures << " handshakes failed\n";
+    bn_free(x_i); g1_free(w1); g2_free(w2);
+}
+// Offline comparison of eager and lazy key updates under bursty revocations. A trace
+// of LAZY_BENCH_UPDATES updates is split into bursts of B; the group key is used once
+// after every burst. Eager runs UpdateMemberSecrets per update, lazy folds updates and
+// materialises at each key use. Reports the member's CPU time for the whole trace.
+void lazy_burst_benchmark()
+{
+    static uint8_t updates[LAZY_BENCH_UPDATES][ECU_DATAGRAM_MAX];
+    static int update_len[LAZY_BENCH_UPDATES];
+    bn_t x_i, x_r;
+    g1_t w1;
+    g2_t w2, w2_eager, A_recv;
+    bn_new(x_i); bn_new(x_r); g1_new(w1); g2_new(w2); g2_new(w2_eager); g2_new(A_recv);
+    SyntheticGroup grp;
+    synthetic_setup(grp);
+    synthetic_issue(grp, x_i, w1, w2);
+    for (int i = 0; i < LAZY_BENCH_UPDATES; ++i)
+        update_len[i] = synthetic_revoke(grp, updates[i], ECU_DATAGRAM_MAX);
+    lazy_alloc(lazy_member);
+    int len_g2 = g2_size_bin(w2, 1);
+
+    cout << "Burst   Eager ms   Lazy ms   CPU saved   Consistent\n";
+    for (int burst = 1; burst <= LAZY_BENCH_UPDATES; burst *= 2) {
+        g2_copy(w2_eager, w2);
+        double start = thread_cpu_ns();
+        for (int i = 0; i < LAZY_BENCH_UPDATES; ++i) {
+            read_key_update(updates[i], update_len[i], len_g2, A_recv, x_r);
+            UpdateMemberSecrets(w1, w2_eager, x_i, A_recv, x_r);
+        }
+        double eager_ns = thread_cpu_ns() - start;
+
+        lazy_init(lazy_member, x_i, w1, w2);
+        bool consistent = true;
+        start = thread_cpu_ns();
+        for (int i = 0; i < LAZY_BENCH_UPDATES; ++i) {
+            consistent &= lazy_fold(lazy_member, updates[i], update_len[i]) == LAZY_FOLDED;
+            if ((i + 1) % burst == 0) lazy_group_key(lazy_member);
+        }
+        double lazy_ns = thread_cpu_ns() - start;
+        consistent &= g2_cmp(lazy_member.w2, w2_eager) == RLC_EQ;
 
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) {
-        perror("socket failed");
-        return;
+        printf("%5d %10.1f %9.1f %10.1f%%   %s\n", burst, eager_ns / 1e6, lazy_ns / 1e6,
+               100.0 * (eager_ns - lazy_ns) / eager_ns, consistent ? "yes" : "NO");
     }
-
-    sockaddr_in serv_addr{};
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(TA_PORT);
-    inet_pton(AF_INET, TA_IP, &serv_addr.sin_addr);
-
-    if (connect(sock, (sockaddr*)&serv_addr, sizeof(serv_addr)) < 0) {
-        perror("connect failed");
+    synthetic_free(grp);
+    bn_free(x_i); bn_free(x_r); g1_free(w1); g2_free(w2); g2_free(w2_eager); g2_free(A_recv);
+}
+// Offline cost of each additional group served by one process: heap held per group
+// credential and member CPU per routed key update, for 1 .. MULTI_BENCH_GROUPS groups.
+// Updates arrive round-robin across the groups and are applied through the same
+// dispatch_key_update as the listener (eager, or folded and materialised with --lazy).
+// Route is the cost of reading the header and finding the group. A process per group
+// would instead pay the per-process baseline (RELIC state, precomputation) each time.
+void multi_group_benchmark()
+{
+    static uint8_t updates[MULTI_BENCH_UPDATES][ECU_DATAGRAM_MAX];
+    static int update_len[MULTI_BENCH_UPDATES];
+    std::vector<SyntheticGroup> tas(MULTI_BENCH_GROUPS);
+    for (int i = 0; i < MULTI_BENCH_GROUPS; ++i) {
+        synthetic_setup(tas[i]);
+        tas[i].id = i + 1;
+    }
+    bn_t check;
+    g2_t expected;
+    bn_new(check); g2_new(expected);
+    free_groups();
+
+    printf("Per-process baseline: %ld KiB peak RSS\n", ecu_peak_rss_kb());
+    printf("Groups   Heap/group B   Update us   Route ns   Consistent\n");
+    for (int n = 1; n <= MULTI_BENCH_GROUPS; n *= 2) {
+        long heap_before = ecu_heap_in_use();
+        for (int i = 0; i < n; ++i) {
+            GroupMember& g = add_group(tas[i].id, TA_PORT);
+            synthetic_issue(tas[i], g.x_i, g.w1, g.w2);
+            g.epoch = g.key_epoch = tas[i].epoch;
+            if (g.lazy) lazy_init(*g.lazy, g.x_i, g.w1, g.w2);
+        }
+        long heap = ecu_heap_in_use() - heap_before;
+        for (int u = 0; u < MULTI_BENCH_UPDATES; ++u)
+            update_len[u] = synthetic_revoke(tas[u % n], updates[u], ECU_DATAGRAM_MAX);
+
+        int applied = 0;
+        double start = thread_cpu_ns();
+        for (int u = 0; u < MULTI_BENCH_UPDATES; ++u)
+            applied += dispatch_key_update(updates[u], update_len[u]) != nullptr;
+        for (auto& [id, g] : groups) {
+            if (!g.lazy) continue;
+            lazy_group_key(*g.lazy);
+            g2_copy(g.w2, g.lazy->w2);
+        }
+        double update_ns = (thread_cpu_ns() - start) / MULTI_BENCH_UPDATES;
+
+        size_t routed = 0;
+        auto route_start = std::chrono::steady_clock::now();
+        for (int r = 0; r < MULTI_BENCH_ROUTE_ROUNDS; ++r) {
+            for (int u = 0; u < MULTI_BENCH_UPDATES; ++u) {
+                uint32_t id;
+                uint64_t epoch;
+                if (key_update_header(updates[u], update_len[u], id, epoch)) routed += groups.count(id);
+            }
+        }
+        double route_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - route_start).count() /
+                          (double(MULTI_BENCH_ROUTE_ROUNDS) * MULTI_BENCH_UPDATES);
+
+        // Every member's w2 must match what its TA would issue under the final A.
+        bool consistent = applied == MULTI_BENCH_UPDATES && routed == size_t(MULTI_BENCH_ROUTE_ROUNDS) * MULTI_BENCH_UPDATES;
+        for (int i = 0; i < n; ++i) {
+            GroupMember& g = groups[tas[i].id];
+            bn_add(check, g.x_i, tas[i].sk);
+            bn_mod_inv(check, check, tas[i].ord);
+            g2_mul(expected, tas[i].A, check);
+            consistent &= g2_cmp(expected, g.w2) == RLC_EQ;
+        }
+        printf("%6d %14ld %11.1f %10.1f   %s\n", n, heap_before >= 0 ? heap / n : -1, update_ns / 1e3, route_ns,
+               consistent ? "yes" : "NO");
+        free_groups();
+    }
+    for (SyntheticGroup& grp : tas) synthetic_free(grp);
+    bn_free(check); g2_free(expected);
+}
+// Cold start from the state file against a fresh registration, for the configured
+// groups. Registration runs the exchange with every group's TA and derives each key
+// with a pairing; resuming maps and decodes the state file; catch-up asks each TA for
+// missed updates (none here). RELIC initialisation, paid by both, is shown apart.
+void cold_start_benchmark()
+{
+    if (state_path.empty()) {
+        std::cerr << "The cold start benchmark needs --state FILE." << std::endl;
         return;
     }
-
-    const char* id = "veh_id_123456";
-    send(sock, id, 16, 0);
-
-    uint8_t buf[2048];
-
-    int offset = 0;
-    int len_xi = bn_size_bin(x_i);
-    int len_g1 = g1_size_bin(w1, 1);
-    int len_g2 = g2_size_bin(w2,1);
-
-    int len;
-    recv(sock, &len, sizeof(len), MSG_WAITALL);  // Receive length
-    uint8_t buffer[1024];
-    recv(sock, buffer, len, MSG_WAITALL);        // Receive data
-    bn_read_bin(x_i, buffer, len);
-    recv(sock, &len, sizeof(len), MSG_WAITALL);  // Receive length
-    recv(sock, buffer, len, MSG_WAITALL);        // Receive data
-    g1_read_bin(w1, buffer, len);
-    
-    recv(sock, &len, sizeof(len), MSG_WAITALL);  // Receive length
-    recv(sock, buffer, len, MSG_WAITALL);        // Receive data
-    g2_read_bin(w2, buffer, len);
-
-    derive_key(w1, w2);
-    close(sock);
-
+    int failures = 0;
+    cout << "RELIC Initialisation:     " << relic_init_ns << " ns\n";
+    auto [reg_avg, reg_std] = benchmark_stats([&] {
+        for (auto& [id, g] : groups) failures += !register_group(g);
+    }, 1, COLDSTART_ROUNDS);
+    cout << "Fresh Registration:       " << reg_avg << " ns (±" << reg_std << ")\n";
+    perf_report("coldstart_register", reg_avg, reg_std);
+    auto [save_avg, save_std] = benchmark_stats(save_state, 1, COLDSTART_ROUNDS);
+    cout << "State Save:               " << save_avg << " ns (±" << save_std << ")\n";
+    perf_report("coldstart_save", save_avg, save_std);
+    auto [resume_avg, resume_std] = benchmark_stats([&] { failures += !load_state(); }, 1, COLDSTART_ROUNDS);
+    cout << "Resume From State:        " << resume_avg << " ns (±" << resume_std << ")\n";
+    perf_report("coldstart_resume", resume_avg, resume_std);
+    auto [catchup_avg, catchup_std] = benchmark_stats([&] {
+        for (auto& [id, g] : groups) failures += catch_up(g) != CAUGHT_UP;
+    }, 1, COLDSTART_ROUNDS);
+    cout << "Catch-up (none missed):   " << catchup_avg << " ns (±" << catchup_std << ")\n";
+    perf_report("coldstart_catchup", catchup_avg, catchup_std);
+    if (failures) cout << failures << " operations failed\n";
 }
 
-int main() {
+int main(int argc, char** argv) {
+    std::vector<std::pair<uint32_t, int>> group_args;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--auth" && i + 1 < argc) {
+            auth_dir = argv[++i];
+        } else if (std::string(argv[i]) == "--lazy") {
+            lazy_updates = true;
+        } else if (std::string(argv[i]) == "--state" && i + 1 < argc) {
+            state_path = argv[++i];
+        } else if (std::string(argv[i]) == "--group" && i + 1 < argc) {
+            char* end;
+            uint32_t id = strtoul(argv[++i], &end, 10);
+            int port = *end == ':' ? atoi(end + 1) : TA_PORT;
+            for (auto& [other, other_port] : group_args) {
+                if (other == id) {
+                    std::cerr << "Group " << id << " given twice." << std::endl;
+                    return 1;
+                }
+            }
+            group_args.push_back({id, port});
+        } else if (!parse_deterministic_option(argc, argv, i)) {
+            std::cerr << "Usage: " << argv[0] << " [--auth DIR] [--lazy] [--group ID[:PORT]]... [--state FILE] [--seed S] [--record FILE | --check FILE]" << std::endl;
+            return 1;
+        }
+    }
+    if (!auth_dir.empty() && !auth_load_identity(auth_dir, VEHICLE_ID, vehicle_auth)) {
+        std::cerr << "Cannot load the vehicle identity from " << auth_dir << std::endl;
+        return 1;
+    }
+    auto init_start = std::chrono::steady_clock::now();
     if (core_init() != RLC_OK || pc_param_set_any() != RLC_OK) {
         std::cerr << "RELIC initialization failed." << std::endl;
         return 1;
     }
+    relic_init_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - init_start).count();
+    seed_apply("vehicle");
+    if (group_args.empty()) group_args.push_back({DEFAULT_GROUP, TA_PORT});
+    for (auto& [id, port] : group_args) add_group(id, port);
+#ifndef SGKD_ECU
+    metrics_serve(METRICS_PORT);
+#endif
     cout<<"========================================================"<<endl;
     cout<<"| Select a test option from the following list:        |"<<endl;
     cout<<"| Press 1 fro the registration end-to-end latency      |"<<endl;
     cout<<"| Press 2 for the update end-to-end latency            |"<<endl;
+    cout<<"| Press 3 for the ECU footprint benchmark (offline)    |"<<endl;
+    cout<<"| Press 4 for the full vs resumed handshake (--auth)   |"<<endl;
+    cout<<"| Press 5 for eager vs lazy updates in bursts (offline)|"<<endl;
+    cout<<"| Press 6 for the cost per additional group (offline)  |"<<endl;
+    cout<<"| Press 7 for cold start vs registration (--state)     |"<<endl;
     cout<<"========================================================"<<endl;
     int scenario=0;
     cin>>scenario;
@@ -322,14 +921,42 @@ int main() {
         {   
             auto [reglatency_avg, reglatency_std] = benchmark_stats(registervehicle_benchmark);
             cout << "Registration Total Latency:" << reglatency_avg << " ns (±" << reglatency_std << ")\n";
+            perf_report("vehicle_registration", reglatency_avg, reglatency_std);
+            if (trace_write_chrome(TRACE_FILE))
+                cout << "Trace written to " << TRACE_FILE << endl;
         }
 
         break;
     case 2:
         {
+#ifdef SGKD_ECU
+            ecu_init();
+            int sockfd = ecu_bind(BROADCAST_PORT);
+            if (sockfd < 0 || !ecu_register(TA_IP, TA_PORT, VEHICLE_ID)) {
+                std::cerr << "Registration failed." << std::endl;
+                return 1;
+            }
+            ecu_listen(sockfd, TA_IP, TA_PORT, VEHICLE_ID);
+#else
             registervehicle();
+#endif
         }
     break;    
+    case 3:
+        ecu_footprint_benchmark();
+        break;
+    case 4:
+        handshake_benchmark();
+        break;
+    case 5:
+        lazy_burst_benchmark();
+        break;
+    case 6:
+        multi_group_benchmark();
+        break;
+    case 7:
+        cold_start_benchmark();
+        break;
     default:
         break;
     }